@@ -0,0 +1,156 @@
+/****************************************************
+  Description:  Checks that the handle version of isValidScene() doesn't allocate once it is warmed up, and compares its
+                speed with the name version.  malloc and its relatives are replaced with ones that count (every form of
+                operator new, plain, array, nothrow and aligned, is routed through them too), the stable scene from
+                testParams.cpp is checked a few times to let the buffers grow and then RUNS more times while counting.
+                Exits with 1 if any of those RUNS calls allocated, on any thread, ODE's included.  It is registered
+                as a test, which passes it the models folder.
+
+                Usage: allocationCheck [models folder]
+****************************************************/
+
+#include "sceneValidator.h"
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <iostream>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <ros/ros.h>
+#include <ros/package.h>
+using namespace std;
+
+#define WARMUP 3   // calls before counting starts
+#define RUNS 100   // calls which are counted
+
+static std::atomic<long> allocations(0);  //allocations while counting
+static std::atomic<bool> counting(false);
+
+
+//glibc's own allocator, the replacements below count and then call these
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void *p, size_t size);
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+
+extern "C" void* malloc(size_t size){
+  if (counting) allocations++;
+  return __libc_malloc(size);
+}
+extern "C" void* calloc(size_t count, size_t size){
+  if (counting) allocations++;
+  return __libc_calloc(count, size);
+}
+extern "C" void* realloc(void *p, size_t size){
+  if (counting) allocations++;
+  return __libc_realloc(p, size);
+}
+extern "C" void* memalign(size_t alignment, size_t size){
+  if (counting) allocations++;
+  return __libc_memalign(alignment, size);
+}
+extern "C" void* aligned_alloc(size_t alignment, size_t size){
+  return memalign(alignment, size);
+}
+extern "C" int posix_memalign(void **p, size_t alignment, size_t size){
+  *p = memalign(alignment, size);
+  return *p ? 0 : ENOMEM;
+}
+
+
+//every form of new goes through malloc (counted there), delete through free
+void* operator new(std::size_t size){
+  void *p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](std::size_t size){ return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return malloc(size ? size : 1); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return malloc(size ? size : 1); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, std::size_t) noexcept { free(p); }
+void operator delete[](void *p, std::size_t) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t&) noexcept { free(p); }
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t alignment){
+  void *p = memalign((size_t)alignment, size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](std::size_t size, std::align_val_t alignment){ return operator new(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return memalign((size_t)alignment, size ? size : 1); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return memalign((size_t)alignment, size ? size : 1); }
+void operator delete(void *p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { free(p); }
+#endif
+
+
+int main (int argc, char **argv)
+{
+  //the models folder from the command line (the test passes it), or found through ROS
+  string models = argc > 1 ? string(argv[1]) : ros::package::getPath("scenevalidator") + "/src/examples/src/models";
+  vector<string> filenames = {models + "/wine_glass.obj", models + "/paper_bowl.obj", models + "/red_mug.obj"};
+  vector<string> modelnames = {"wine_glass", "paper_bowl", "red_mug"};
+
+  SceneValidator *scene = new SceneValidator(0,0,-0.5,0,0,1,0,100);
+  scene->setScale(1, 200);    //paper bowl is much bigger than the others
+  vector<int> handles = scene->setModels(modelnames, filenames);
+
+  //the stable scene from testParams.cpp, all three upright (quaternion 0.5,0.5,0,0)
+  ModelPose poses[3] = {
+    {handles[0], {-4, 0, 1.25}, {0.5, 0.5, 0, 0}},
+    {handles[1], { 0, 0, 0.13}, {0.5, 0.5, 0, 0}},
+    {handles[2], { 4, 0, 0.66}, {0.5, 0.5, 0, 0}} };
+  vector<Eigen::Affine3d> affines;
+  for (int i = 0; i < 3; i++){
+    Eigen::Quaterniond q(0.5, 0.5, 0, 0);
+    q.normalize();
+    affines.push_back(Eigen::Translation3d(Eigen::Vector3d(poses[i].position[0], poses[i].position[1], poses[i].position[2])) * Eigen::Affine3d(q));
+  }
+
+  for (int i = 0; i < WARMUP; i++){
+    scene->isValidScene(poses, 3);
+  }
+
+  //handle version, counted
+  int valid = 0;
+  allocations = 0;
+  counting = true;
+  auto start = chrono::high_resolution_clock::now();
+  for (int i = 0; i < RUNS; i++){
+    valid += scene->isValidScene(poses, 3);
+  }
+  auto finish = chrono::high_resolution_clock::now();
+  counting = false;
+  long handleAllocations = allocations;
+  printf("handles: valid %d/%d, %.3f ms per check, %ld allocations\n", valid, RUNS,
+         chrono::duration<double, milli>(finish - start).count() / RUNS, handleAllocations);
+
+  //name version for comparison
+  valid = 0;
+  allocations = 0;
+  counting = true;
+  start = chrono::high_resolution_clock::now();
+  for (int i = 0; i < RUNS; i++){
+    valid += scene->isValidScene(modelnames, affines);
+  }
+  finish = chrono::high_resolution_clock::now();
+  counting = false;
+  printf("names:   valid %d/%d, %.3f ms per check, %ld allocations\n", valid, RUNS,
+         chrono::duration<double, milli>(finish - start).count() / RUNS, (long)allocations);
+
+  delete scene;
+  if (handleAllocations > 0){
+    cout<<"FAILED: the handle version allocated"<<endl;
+    return 1;
+  }
+  cout<<"OK: no allocations in the handle version"<<endl;
+  return 0;
+}
@@ -0,0 +1,94 @@
+/****************************************************
+  Description:  This program runs the same scenes through the default ODE backend and the built in impulse
+                backend and prints each backend's verdicts and how long it took.  There are two sets of scenes:
+                the three objects of testParams.cpp side by side on the ground (stable, and with the wine glass
+                tipped over), and the tower of build_tower.cpp, bowl, mug and dog stacked on each other (stable,
+                and with the dog hanging off the mug's edge).  Both are small scenes of three objects, so the
+                numbers say little about crowded scenes or scenes with many contacts.
+****************************************************/
+
+#include "sceneValidator.h"
+#include "impulseBackend.h"
+#include <chrono>
+#include <stdio.h>
+#include <iostream>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <ros/ros.h>
+#include <ros/package.h>
+using namespace std;
+
+
+//get file path for models
+const string wine_glass = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/wine_glass.obj";
+
+const string paper_bowl = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/paper_bowl.obj";
+
+const string red_mug = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/red_mug.obj";
+
+const string dog = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/dog.obj";
+
+#define RUNS 10   // how many times each scene is checked
+
+
+/* makes a pose from a quaternion (w,x,y,z) and a position */
+Eigen::Affine3d makePose(double qw, double qx, double x, double y, double z){
+  Eigen::Quaterniond q(qw, qx, 0, 0);
+  q.normalize();
+  return Eigen::Translation3d(Eigen::Vector3d(x,y,z)) * Eigen::Affine3d(q);
+}
+
+
+/* checks every scene RUNS times and prints the verdicts and the average time per check */
+void runBenchmark(SceneValidator *scene, string backendName, vector<string> modelnames, vector< vector<Eigen::Affine3d> > scenes){
+  for (int s = 0; s < scenes.size(); s++){
+    int valid = 0;
+    auto start = chrono::high_resolution_clock::now();
+    for (int i = 0; i < RUNS; i++){
+      if (scene->isValidScene(modelnames, scenes[s])){
+        valid++;
+      }
+    }
+    auto finish = chrono::high_resolution_clock::now();
+    double ms = chrono::duration<double, milli>(finish - start).count() / RUNS;
+    printf("%-8s %-8s scene %d: valid %d/%d times, %.2f ms per check, %d steps\n", backendName.c_str(), modelnames[0].c_str(), s+1, valid, RUNS, ms, scene->getSimulationStats().steps);
+  }
+}
+
+
+/* runs the scenes of one set of models through both backends */
+void compareBackends(vector<string> modelnames, vector<string> filenames, vector<double> scales, vector< vector<Eigen::Affine3d> > scenes){
+  SceneValidator *scene = new SceneValidator(0,0,-0.5,0,0,1,0,100);
+  for (int i = 0; i < scales.size(); i++){
+    scene->setScale(i, scales[i]);
+  }
+  scene->setModels(modelnames, filenames);
+
+  runBenchmark(scene, "ode", modelnames, scenes);
+
+  scene->setBackend(new ImpulseBackend());  //same models and parameters, different engine
+  runBenchmark(scene, "impulse", modelnames, scenes);
+
+  delete scene;
+}
+
+
+int main (int argc, char **argv)
+{
+  //side by side: scene 1 is stable, scene 2 has the wine glass tipped over
+  vector<Eigen::Affine3d> stable = {makePose(0.5,0.5, -4,0,1.25), makePose(0.5,0.5, 0,0,0.13), makePose(0.5,0.5, 4,0,0.66)};
+  vector<Eigen::Affine3d> unstable = {makePose(0.3,0.7, -2,0,1.59), makePose(0.5,0.5, 0,0,0.13), makePose(0.5,0.5, 4,0,0.66)};
+  compareBackends({"wine_glass", "paper_bowl", "red_mug"}, {wine_glass, paper_bowl, red_mug}, {100, 200, 100},  //paper bowl is much bigger than the others
+                  {stable, unstable});
+
+  //stacked: scene 1 is the tower build_tower.cpp finds, scene 2 has the dog moved off the top of the mug
+  vector<Eigen::Affine3d> tower = {makePose(0.5,0.5, 0,0,0.27), makePose(0.5,0.5, 0,0,1.13), makePose(0.5,0.5, 0,0,2.03)};
+  vector<Eigen::Affine3d> overhang = {makePose(0.5,0.5, 0,0,0.27), makePose(0.5,0.5, 0,0,1.13), makePose(0.5,0.5, 0.9,0,2.03)};
+  compareBackends({"paper_bowl", "red_mug", "dog"}, {paper_bowl, red_mug, dog}, {100, 100, 10},  //the dog is scaled down by 10 like in build_tower.cpp
+                  {tower, overhang});
+  return 0;
+}
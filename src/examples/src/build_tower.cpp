@@ -101,10 +101,10 @@ int main (int argc, char **argv)
 
   /* Search #1: find lowest stable position for paper_bowl*/
 
-  // construct object and set parameters
-  SceneValidator *scene = new SceneValidator;   // construct object and set parameters
+  // get a validator holding the models from the process wide pool, instead of constructing one for every search
+  ValidatorPool &pool = ValidatorPool::process();
+  SceneValidator *scene = pool.checkout(modelnames1, filenames1);   // the model's data is ready for simulation
   //scene->setParams("DRAW", true);             //you could draw the search if you want
-  scene-> setModels(modelnames1, filenames1);   // set all the model's data to be ready for simulation
   scene-> setParams("THRESHOLD", 0.01);         // set the threshold to be 0.01
   double i = 0;       // this is where the bowl will start testing stability positions
   while(i <= 3){      // 3 is the highest z we will allow to be possibly in the search space
@@ -117,15 +117,14 @@ int main (int argc, char **argv)
      }  
      i=i+0.01;   //increment by 0.01 (that'll be our resolution)
   }
-  delete scene;
+  pool.checkin(scene);
   
  
 
   /* Search #2: find lowest stable position for red_mug (on top of paper_bowl) */
 
-  SceneValidator *scene2 = new SceneValidator;
+  SceneValidator *scene2 = pool.checkout(modelnames2, filenames2);
   //scene2->setParams("DRAW", true);            //you could draw the search if you want
-  scene2->setModels(modelnames2, filenames2);
   scene2->setParams("THRESHOLD", 0.04); //decided threshold to be 0.04.  using 0.01 might find not solutions  
   //i = model_poses[0].translation()[2]*2;  //you could make i start at 2*(the stable z position that was just found)
   i=1.0;          //I just chose the z position search to start at this number 
@@ -139,14 +138,13 @@ int main (int argc, char **argv)
      }  
      i=i+0.01;
   }
-  delete scene2;
+  pool.checkin(scene2);
 
   /* Search #3: find lowest stable position for dog (on top of red_mug and paper_bowl) */
 
-  SceneValidator *scene3  = new SceneValidator;
+  //need to scale the 2rd item (vector[2] = dog) down by factor of 10 (default is 100)
+  SceneValidator *scene3  = pool.checkout(modelnames3, filenames3, {100, 100, 10});
   //scene3 ->setParams("DRAW", true);   //you could draw the search if you want
-  scene3->setScale(2,10);               //need to scale the 2rd item (vector[2] = dog) down by factor of 10 (default is 100)
-  scene3 ->setModels(modelnames3, filenames3);
   scene3 ->setParams("THRESHOLD", 0.05); //decided threshold to be 0.04
   //i=model_poses[1].translation()[2]; //could start i based on position that was previusly found
   i=1.8;  //decided to choose to start search at this numeber
@@ -175,7 +173,7 @@ int main (int argc, char **argv)
   scene3->setParams("STEP4", 1000);               //4th check is set to super long time so viewer can have time to see the configuration
   scene3->isValidScene(modelnames3, model_poses); //run the simulator on scene we know is valid and highest
   
-  delete scene3 ;
+  pool.checkin(scene3);
 
   //program is finished
   return 0;
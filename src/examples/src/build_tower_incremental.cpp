@@ -0,0 +1,80 @@
+/****************************************************
+  Description:  Same search as build_tower.cpp (paper bowl, then red mug, then dog, each at its lowest stable height) but with
+                the incremental API.  Once an object is found, the tower so far is committed and the next object is checked
+                against it with isValidWithCommitted(), which starts from where the tower settled and keeps it asleep unless
+                the new object disturbs it.  Only one SceneValidator is needed for the whole search.
+****************************************************/
+
+#include "sceneValidator.h"
+#include <chrono>
+#include <stdio.h>
+#include <iostream>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <ros/ros.h>
+#include <ros/package.h>
+using namespace std;
+
+
+//get file paths for models
+const string paper_bowl = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/paper_bowl.obj";
+
+const string red_mug = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/red_mug.obj";
+
+const string dog = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/dog.obj";
+
+
+/* upright pose at height z */
+Eigen::Affine3d upright(double z){
+  Eigen::Quaterniond q(0.5, 0.5, 0, 0);  //orientation is just standard identity matrix
+  q.normalize();
+  return Eigen::Translation3d(Eigen::Vector3d(0,0,z)) * Eigen::Affine3d(q);
+}
+
+
+int main (int argc, char **argv)
+{
+  vector<string> filenames = {paper_bowl, red_mug, dog};
+  vector<string> modelnames = {"paper_bowl", "red_mug", "dog"};
+
+  static chrono::steady_clock::time_point startTime, endTime;
+  startTime = chrono::steady_clock::now(); //start the timer
+
+  SceneValidator *scene = new SceneValidator;
+  scene->setScale(2,10);                 //dog needs to be scaled down by 10 instead of 100
+  scene->setModels(modelnames, filenames);
+
+  /* Search #1: lowest stable position for the paper bowl, committed once found */
+  scene->setParams("THRESHOLD", 0.01);
+  double bowl = -1;
+  for (double z = 0; z <= 3 && bowl < 0; z += 0.01){
+    if (scene->commitScene({"paper_bowl"}, {upright(z)})){
+      bowl = z;
+    }
+  }
+  cout<<"TRUE paper bowl z pos at "<<bowl<<endl;
+
+  /* Search #2 and #3: each object is checked against the committed tower and joins it once it's stable */
+  vector<string> next = {"red_mug", "dog"};
+  vector<double> start = {1.0, 1.8};
+  vector<double> threshold = {0.04, 0.05};
+  for (int n = 0; n < next.size(); n++){
+    scene->setParams("THRESHOLD", threshold[n]);
+    double found = -1;
+    for (double z = start[n]; z <= 3 && found < 0; z += 0.01){
+      if (scene->isValidWithCommitted(next[n], upright(z), true)){
+        found = z;
+      }
+    }
+    cout<<"TRUE "<<next[n]<<" z pos at "<<found<<endl;
+  }
+
+  endTime = chrono::steady_clock::now();
+  cout <<"Time: "<< chrono::duration <double, milli> (endTime - startTime).count() << " ms" << endl;
+
+  delete scene;
+  return 0;
+}
@@ -0,0 +1,106 @@
+/****************************************************
+  Description:  Load test of the validation daemon.  Start the daemon with the models of tabletop.manifest:
+                    sceneValidatorDaemon src/examples/src/models/tabletop.manifest
+                then run this.  Each of THREADS threads opens its own connection and keeps INFLIGHT copies of the
+                stable scene from testParams.cpp in flight until it has sent SCENES of them.  It prints the throughput
+                and the latency (from sending a scene to getting its verdict) percentiles.
+
+                Usage: loadTestClient [socket path] [threads] [scenes per thread] [scenes in flight per thread]
+****************************************************/
+
+#include "validationClient.h"
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+using namespace std;
+
+#define THREADS 4      // default number of client threads
+#define SCENES 1000    // default scenes each thread sends
+#define INFLIGHT 4     // default scenes each thread keeps in flight
+
+
+/* one client thread, latencies gets the milliseconds each scene took */
+static void run(string socketPath, int scenes, int inFlight, vector<double> *latencies, int *errors){
+  ValidationClient client;
+  if (!client.connect(socketPath)){
+    *errors = scenes;
+    return;
+  }
+  int glass = client.getModelHandle("wine_glass");
+  int bowl = client.getModelHandle("paper_bowl");
+  int mug = client.getModelHandle("red_mug");
+  if (glass < 0 || bowl < 0 || mug < 0){
+    cout<<"***ERROR*** in loadTestClient. The daemon hasn't loaded wine_glass, paper_bowl and red_mug"<<endl;
+    *errors = scenes;
+    return;
+  }
+  //the stable scene from testParams.cpp
+  ModelPose poses[3] = {
+    {glass, {-4, 0, 1.25}, {0.5, 0.5, 0, 0}},
+    {bowl,  { 0, 0, 0.13}, {0.5, 0.5, 0, 0}},
+    {mug,   { 4, 0, 0.66}, {0.5, 0.5, 0, 0}} };
+
+  vector<chrono::steady_clock::time_point> sent(scenes + 1);  //ids are 1, 2, 3...
+  int sending = 0, received = 0;
+  while (received < scenes){
+    while (sending < scenes && sending - received < inFlight){
+      uint32_t id = client.sendScene(poses, 3);
+      if (id == 0 || id > scenes){
+        *errors += scenes - received;
+        return;
+      }
+      sent[id] = chrono::steady_clock::now();
+      sending++;
+    }
+    uint32_t id;
+    int verdict = client.receiveVerdict(id);
+    if (verdict < 0 || id == 0 || id > scenes){
+      *errors += scenes - received;
+      return;
+    }
+    latencies->push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - sent[id]).count());
+    received++;
+  }
+}
+
+
+int main (int argc, char **argv)
+{
+  string socketPath = argc > 1 ? argv[1] : SV_SOCKET_PATH;
+  int threads = argc > 2 ? atoi(argv[2]) : THREADS;
+  int scenes = argc > 3 ? atoi(argv[3]) : SCENES;
+  int inFlight = argc > 4 ? atoi(argv[4]) : INFLIGHT;
+
+  vector< vector<double> > latencies(threads);
+  vector<int> errors(threads, 0);
+  vector<std::thread> clients;
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < threads; i++){
+    clients.push_back(std::thread(run, socketPath, scenes, inFlight, &latencies[i], &errors[i]));
+  }
+  for (int i = 0; i < threads; i++){
+    clients[i].join();
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  vector<double> all;
+  int failed = 0;
+  for (int i = 0; i < threads; i++){
+    all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+    failed += errors[i];
+  }
+  if (all.empty()){
+    cout<<"No verdicts came back, is sceneValidatorDaemon running at "<<socketPath<<"?"<<endl;
+    return 1;
+  }
+  sort(all.begin(), all.end());
+  printf("%d threads, %d in flight each: %d scenes in %.2f s, %.1f scenes/s, %d failed\n",
+         threads, inFlight, (int)all.size(), seconds, all.size() / seconds, failed);
+  printf("latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+         all[all.size()*50/100], all[all.size()*90/100], all[all.size()*99/100], all.back());
+  return failed > 0;
+}
@@ -0,0 +1,62 @@
+/****************************************************
+  Description:  Same tower as build_tower.cpp (paper bowl, then red mug, then dog) but each object's height comes from
+                findPlacement(), which lowers it onto the tower until it touches and validates it once, instead of
+                stepping z by 0.01 and calling isValidScene() at every step.
+****************************************************/
+
+#include "sceneValidator.h"
+#include <chrono>
+#include <stdio.h>
+#include <iostream>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <ros/ros.h>
+#include <ros/package.h>
+using namespace std;
+
+
+//get file paths for models
+const string paper_bowl = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/paper_bowl.obj";
+
+const string red_mug = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/red_mug.obj";
+
+const string dog = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/dog.obj";
+
+
+int main (int argc, char **argv)
+{
+  vector<string> filenames = {paper_bowl, red_mug, dog};
+  vector<string> modelnames = {"paper_bowl", "red_mug", "dog"};
+  vector<double> threshold = {0.01, 0.04, 0.05};  //the same THRESHOLDs build_tower.cpp uses
+
+  static chrono::steady_clock::time_point startTime, endTime;
+  startTime = chrono::steady_clock::now(); //start the timer
+
+  SceneValidator *scene = new SceneValidator;
+  scene->setScale(2,10);                 //dog needs to be scaled down by 10 instead of 100
+  scene->setModels(modelnames, filenames);
+  if (argc > 1){                         //any argument switches to the bisection search
+    scene->setParams("PLACEMENT_BISECT", 1);
+  }
+
+  for (int n = 0; n < modelnames.size(); n++){
+    scene->setParams("THRESHOLD", threshold[n]);
+    Eigen::Quaterniond q(0.5, 0.5, 0, 0);  //orientation is just standard identity matrix
+    q.normalize();
+    Eigen::Affine3d pose = Eigen::Translation3d(Eigen::Vector3d(0,0,0)) * Eigen::Affine3d(q);  //only x, y and orientation matter
+    bool stable = scene->findPlacement(modelnames[n], pose, true);
+    cout<<modelnames[n]<<" placed at z = "<<pose.translation()[2]<<(stable ? " (stable)" : " (NOT stable)")<<endl;
+    if (!stable){
+      break;
+    }
+  }
+
+  endTime = chrono::steady_clock::now();
+  cout <<"Time: "<< chrono::duration <double, milli> (endTime - startTime).count() << " ms" << endl;
+
+  delete scene;
+  return 0;
+}
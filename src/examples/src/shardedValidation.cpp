@@ -0,0 +1,94 @@
+/****************************************************
+  Description:  Checks the stable scene from testParams.cpp SCENES times with one SceneValidator and then spread over
+                worker processes with a ShardedValidator, and prints the scenes per second of both.  Then it kills one
+                worker and checks the scenes again to show that only the scene the worker was simulating is lost (its
+                verdict is -1) and the worker is forked again.
+
+                Usage: shardedValidation [workers]
+****************************************************/
+
+#include "sceneValidator.h"
+#include "shardedValidator.h"
+#include <chrono>
+#include <thread>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <ros/ros.h>
+#include <ros/package.h>
+using namespace std;
+
+#define SCENES 400   // scenes checked each time
+
+
+//get file path for models
+const string wine_glass = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/wine_glass.obj";
+
+const string paper_bowl = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/paper_bowl.obj";
+
+const string red_mug = ros::package::getPath("scenevalidator") +
+                         "/src/examples/src/models/red_mug.obj";
+
+
+/* counts the verdicts of each kind */
+static void printVerdicts(const char *what, const vector<int> &verdicts, double seconds){
+  int valid = 0, invalid = 0, lost = 0;
+  for (int i = 0; i < verdicts.size(); i++){
+    if (verdicts[i] == 1) valid++;
+    else if (verdicts[i] == 0) invalid++;
+    else lost++;
+  }
+  printf("%s: %d valid, %d invalid, %d lost, %.1f scenes/s\n", what, valid, invalid, lost, verdicts.size() / seconds);
+}
+
+
+int main (int argc, char **argv)
+{
+  int workers = argc > 1 ? atoi(argv[1]) : std::thread::hardware_concurrency();
+  vector<string> filenames = {wine_glass, paper_bowl, red_mug};
+  vector<string> modelnames = {"wine_glass", "paper_bowl", "red_mug"};
+  vector<double> scales = {100, 200, 100};  //paper bowl is much bigger than the others
+
+  //forked first, while this is the only thread
+  ShardedValidator sharded(workers, modelnames, filenames, scales);
+
+  //the stable scene from testParams.cpp, all three upright
+  vector<ModelPose> scene = {
+    {0, {-4, 0, 1.25}, {0.5, 0.5, 0, 0}},
+    {1, { 0, 0, 0.13}, {0.5, 0.5, 0, 0}},
+    {2, { 4, 0, 0.66}, {0.5, 0.5, 0, 0}} };
+  vector< vector<ModelPose> > scenes(SCENES, scene);
+
+  //one validator in this process
+  SceneValidator *validator = new SceneValidator();
+  for (int i = 0; i < scales.size(); i++){
+    validator->setScale(i, scales[i]);
+  }
+  validator->setModels(modelnames, filenames);
+  vector<int> verdicts(SCENES);
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < SCENES; i++){
+    verdicts[i] = validator->isValidScene(scenes[i].data(), scenes[i].size());
+  }
+  printVerdicts("1 validator", verdicts, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  delete validator;
+
+  //the workers, the first call also waits for them to load the models
+  sharded.isValidScene(scene.data(), scene.size());
+  start = chrono::steady_clock::now();
+  verdicts = sharded.isValidScenes(scenes);
+  printf("%d workers ", workers);
+  printVerdicts("", verdicts, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+  //a worker crashing in the middle of a batch
+  kill(sharded.getWorkerProcess(0), SIGKILL);
+  start = chrono::steady_clock::now();
+  verdicts = sharded.isValidScenes(scenes);
+  printf("one worker killed ");
+  printVerdicts("", verdicts, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  printf("workers forked again: %d\n", sharded.getRestarts());
+  return 0;
+}
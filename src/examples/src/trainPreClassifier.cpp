@@ -0,0 +1,110 @@
+/****************************************************
+  Description:  Trains the pre-classifier from a log of scenes and their isValidScene() verdicts.
+
+                trainPreClassifier models.txt scenes.log out.txt [false reject rate] [false accept rate]
+
+                models.txt has one model per line:  name path/to/model.obj [scale]
+                scenes.log has one scene per line:  verdict n name x y z qw qx qy qz ... (n objects, verdict 1 or 0)
+                The rates default to 0.01.  Load out.txt with SceneValidator::loadPreClassifier() and turn it on
+                with setParams("PRECLASSIFIER", 1).
+****************************************************/
+
+#include "sceneValidator.h"
+#include "preClassifier.h"
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <iostream>
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+using namespace std;
+
+
+int main (int argc, char **argv)
+{
+  if (argc < 4){
+    cout<<"usage: trainPreClassifier models.txt scenes.log out.txt [false reject rate] [false accept rate]"<<endl;
+    return 1;
+  }
+  double falseReject = argc > 4 ? atof(argv[4]) : 0.01;
+  double falseAccept = argc > 5 ? atof(argv[5]) : falseReject;
+
+  //load the models
+  vector<string> modelnames, filenames;
+  vector<double> scales;
+  ifstream models(argv[1]);
+  string line;
+  while (getline(models, line)){
+    istringstream fields(line);
+    string name, path;
+    double scale = -1;
+    if (!(fields>>name>>path)) continue;
+    fields>>scale;
+    modelnames.push_back(name);
+    filenames.push_back(path);
+    scales.push_back(scale);
+  }
+  SceneValidator *scene = new SceneValidator;
+  for (int i = 0; i < scales.size(); i++){
+    if (scales[i] > 0) scene->setScale(i, scales[i]);
+  }
+  scene->setModels(modelnames, filenames);
+
+  //features of every logged scene
+  vector< vector<double> > features;
+  vector<bool> verdicts;
+  ifstream log(argv[2]);
+  int skipped = 0;
+  while (getline(log, line)){
+    istringstream fields(line);
+    int verdict, n;
+    if (!(fields>>verdict>>n)) continue;
+    vector<string> names(n);
+    vector<Eigen::Affine3d> poses(n);
+    for (int i = 0; i < n; i++){
+      double x, y, z, qw, qx, qy, qz;
+      fields>>names[i]>>x>>y>>z>>qw>>qx>>qy>>qz;
+      Eigen::Quaterniond q(qw, qx, qy, qz);
+      q.normalize();
+      poses[i] = Eigen::Translation3d(Eigen::Vector3d(x,y,z)) * Eigen::Affine3d(q);
+    }
+    vector<double> f = fields ? scene->getSceneFeatures(names, poses) : vector<double>();
+    if (f.empty()){
+      skipped++;
+      continue;
+    }
+    features.push_back(f);
+    verdicts.push_back(verdict != 0);
+  }
+  cout<<features.size()<<" scenes read, "<<skipped<<" skipped"<<endl;
+  delete scene;  //only needed for the features
+
+  PreClassifier classifier;
+  if (!classifier.train(features, verdicts, falseReject, falseAccept)){
+    cout<<"***ERROR*** couldn't train, the log needs valid and invalid scenes (and at least 5 of them)"<<endl;
+    return 1;
+  }
+
+  //how it does on the whole log
+  int decided = 0, valid = 0, invalid = 0, falseRejects = 0, falseAccepts = 0;
+  for (int i = 0; i < features.size(); i++){
+    int verdict = classifier.classify(features[i].data());
+    if (verdict >= 0) decided++;
+    if (verdicts[i]){
+      valid++;
+      if (verdict == 0) falseRejects++;
+    } else {
+      invalid++;
+      if (verdict == 1) falseAccepts++;
+    }
+  }
+  cout<<"decides "<<100.0*decided/features.size()<<"% of the scenes without simulating"<<endl;
+  cout<<"false rejects: "<<falseRejects<<" of "<<valid<<" valid scenes"<<endl;
+  cout<<"false accepts: "<<falseAccepts<<" of "<<invalid<<" invalid scenes"<<endl;
+
+  if (!classifier.save(argv[3])){
+    cout<<"***ERROR*** couldn't write "<<argv[3]<<endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+/****************************************************
+  Description:  Tries out the validator nodelet (see validatorNodelet.cpp):  roslaunch scenevalidator validator.launch
+                It looks up the models' handles, checks HYPOTHESES hypotheses with the validate_scenes service, then sends
+                the same hypotheses on scene_batches and prints the verdicts as they stream back on scene_verdicts.
+                Every other hypothesis is the stable scene from testParams.cpp, the rest have the mug floating in the air.
+                This is a separate node, so its messages are serialised.  A nodelet loaded into the same manager which
+                publishes SceneBatch::Ptr hands the nodelet its batches without that.
+****************************************************/
+
+#include <scenevalidator/SceneBatch.h>
+#include <scenevalidator/SceneVerdict.h>
+#include <scenevalidator/ValidateScenes.h>
+#include <scenevalidator/GetModels.h>
+#include <ros/ros.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdio.h>
+using namespace std;
+
+#define HYPOTHESES 20   // hypotheses sent each way
+
+static int streamed = 0, streamedValid = 0;
+static bool batchDone = false;
+
+
+/* a verdict streaming back */
+static void verdictReceived(const scenevalidator::SceneVerdict::ConstPtr &verdict){
+  streamed++;
+  streamedValid += verdict->verdict == 1;
+  printf("batch %u hypothesis %u: %d (%u to come)\n", verdict->batch_id, verdict->hypothesis, verdict->verdict, verdict->remaining);
+  batchDone = verdict->remaining == 0;
+}
+
+
+/* appends one object to the flat arrays */
+static void addObject(vector<int32_t> &handles, vector<double> &poses, int handle, double x, double y, double z){
+  handles.push_back(handle);
+  double pose[7] = {x, y, z, 0.5, 0.5, 0, 0};  //upright, quaternion w x y z
+  poses.insert(poses.end(), pose, pose + 7);
+}
+
+
+int main (int argc, char **argv)
+{
+  ros::init(argc, argv, "validateOverRos");
+  ros::NodeHandle handle;
+  ros::Subscriber verdicts = handle.subscribe("scene_verdicts", 100, verdictReceived);
+  ros::Publisher batches = handle.advertise<scenevalidator::SceneBatch>("scene_batches", 10);
+
+  //handles of the models
+  ros::service::waitForService("get_models");
+  scenevalidator::GetModels models;
+  ros::ServiceClient modelClient = handle.serviceClient<scenevalidator::GetModels>("get_models");
+  if (!modelClient.call(models)){
+    printf("get_models failed\n");
+    return 1;
+  }
+  int glass = -1, bowl = -1, mug = -1;
+  for (int i = 0; i < models.response.names.size(); i++){
+    if (models.response.names[i] == "wine_glass") glass = i;
+    if (models.response.names[i] == "paper_bowl") bowl = i;
+    if (models.response.names[i] == "red_mug") mug = i;
+  }
+  if (glass < 0 || bowl < 0 || mug < 0){
+    printf("the nodelet hasn't loaded wine_glass, paper_bowl and red_mug\n");
+    return 1;
+  }
+
+  //the hypotheses
+  scenevalidator::SceneBatch::Ptr batch(new scenevalidator::SceneBatch());
+  batch->batch_id = 1;
+  for (int h = 0; h < HYPOTHESES; h++){
+    batch->objects.push_back(3);
+    addObject(batch->handles, batch->poses, glass, -4, 0, 1.25);
+    addObject(batch->handles, batch->poses, bowl, 0, 0, 0.13);
+    addObject(batch->handles, batch->poses, mug, 4, 0, h % 2 ? 2.0 : 0.66);
+  }
+
+  //the service
+  scenevalidator::ValidateScenes validate;
+  validate.request.objects = batch->objects;
+  validate.request.handles = batch->handles;
+  validate.request.poses = batch->poses;
+  ros::ServiceClient validateClient = handle.serviceClient<scenevalidator::ValidateScenes>("validate_scenes");
+  auto start = chrono::steady_clock::now();
+  if (!validateClient.call(validate)){
+    printf("validate_scenes failed\n");
+    return 1;
+  }
+  int valid = 0;
+  for (int h = 0; h < validate.response.verdicts.size(); h++){
+    valid += validate.response.verdicts[h] == 1;
+  }
+  printf("validate_scenes: %d of %d valid in %.1f ms\n", valid, HYPOTHESES,
+         chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+
+  //the topics
+  while (batches.getNumSubscribers() == 0 && ros::ok()){
+    ros::Duration(0.05).sleep();
+  }
+  start = chrono::steady_clock::now();
+  batches.publish(batch);
+  while (!batchDone && ros::ok()){
+    ros::spinOnce();
+    ros::Duration(0.001).sleep();
+  }
+  printf("scene_batches: %d of %d valid in %.1f ms\n", streamedValid, streamed,
+         chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+  return 0;
+}
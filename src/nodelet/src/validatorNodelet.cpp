@@ -0,0 +1,254 @@
+/****************************************************
+  Description:  ROS front end of the scene validator, as a nodelet so a perception nodelet in the same manager hands it
+                hypotheses as shared pointers, without serialising them or copying them into Eigen types.
+                  scene_batches   (SceneBatch, in)      hypotheses to check
+                  scene_verdicts  (SceneVerdict, out)   one per hypothesis, published as soon as it is decided
+                  validate_scenes (ValidateScenes)      checks hypotheses and answers when they are all done
+                  get_models      (GetModels)           the model names, a model's handle is the index of its name
+                Private parameters: ~manifest (see modelManifest.h, required) and ~workers (threads, default 2).
+                Every worker has a SceneValidator from a ValidatorPool holding the manifest's models, and the
+                hypotheses of a batch are spread over all of them.
+****************************************************/
+
+#include "sceneValidator.h"
+#include "modelManifest.h"
+#include <scenevalidator/SceneBatch.h>
+#include <scenevalidator/SceneVerdict.h>
+#include <scenevalidator/ValidateScenes.h>
+#include <scenevalidator/GetModels.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <ros/ros.h>
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
+
+#define WORKERS 2   // default number of worker threads
+
+namespace scenevalidator {
+
+
+/* what the hypotheses of one batch (from the topic or the service) share */
+struct BatchState {
+  SceneBatch::ConstPtr batch;             //keeps a topic batch alive while its hypotheses are checked, null for the service
+  uint32_t batchId;
+  std::vector<int8_t> *verdicts;          //where the service's verdicts go, null for the topic
+  std::atomic<int> remaining;             //hypotheses not decided yet
+  std::mutex mutex;
+  std::condition_variable finished;       //the service waits on this
+};
+
+/* one hypothesis waiting for a worker, pointing into its batch's arrays */
+struct HypothesisJob {
+  std::shared_ptr<BatchState> state;
+  int hypothesis;
+  int count;                              //objects
+  const int32_t *handles;
+  const double *poses;                    //7 per object
+};
+
+
+class ValidatorNodelet : public nodelet::Nodelet{
+    public:
+        ValidatorNodelet() : pool(0), quit(false) {}
+        ~ValidatorNodelet();
+
+    private:
+        virtual void onInit();
+        void batchReceived(const SceneBatch::ConstPtr &batch);
+        bool validateScenes(ValidateScenes::Request &request, ValidateScenes::Response &response);
+        bool getModels(GetModels::Request &request, GetModels::Response &response);
+        bool queueBatch(std::shared_ptr<BatchState> state, const std::vector<uint32_t> &objects,
+                        const std::vector<int32_t> &handles, const std::vector<double> &poses);
+        void decided(BatchState &state, int hypothesis, int verdict);
+        void work();
+
+        ModelManifest manifest;
+        ValidatorPool *pool;
+        std::vector<std::thread> workers;
+        std::deque<HypothesisJob> jobs;
+        std::mutex jobMutex;
+        std::condition_variable jobQueued;
+        bool quit;
+        ros::Subscriber batches;
+        ros::Publisher verdicts;
+        ros::ServiceServer validateService, modelsService;
+};
+
+
+void ValidatorNodelet::onInit(){
+  ros::NodeHandle &privateHandle = getPrivateNodeHandle();
+  ros::NodeHandle &handle = getMTNodeHandle();  //so a service call waiting for its verdicts doesn't hold up the topic
+  std::string manifestFile;
+  int workerCount;
+  privateHandle.param("workers", workerCount, WORKERS);
+  if (!privateHandle.getParam("manifest", manifestFile) || !manifest.read(manifestFile) || manifest.names.empty()){
+    NODELET_ERROR("ValidatorNodelet needs ~manifest, a model manifest with at least one model");
+    return;
+  }
+
+  //load the models, the workers check their validators out again in their own threads
+  pool = new ValidatorPool(std::max(workerCount, 1));
+  std::vector<SceneValidator*> validators;
+  for (int i = 0; i < std::max(workerCount, 1); i++){
+    validators.push_back(pool->checkout(manifest.names, manifest.files, manifest.scales));
+  }
+  for (int i = 0; i < manifest.params.size(); i++){  //parameters are shared by every SceneValidator
+    validators[0]->setParams(manifest.params[i].first, manifest.params[i].second);
+  }
+  for (int i = 0; i < validators.size(); i++){
+    pool->checkin(validators[i]);
+    workers.push_back(std::thread(&ValidatorNodelet::work, this));
+  }
+
+  verdicts = handle.advertise<SceneVerdict>("scene_verdicts", 100);
+  batches = handle.subscribe("scene_batches", 10, &ValidatorNodelet::batchReceived, this);
+  validateService = handle.advertiseService("validate_scenes", &ValidatorNodelet::validateScenes, this);
+  modelsService = handle.advertiseService("get_models", &ValidatorNodelet::getModels, this);
+  NODELET_INFO("ValidatorNodelet checking scenes of %d models with %d workers", (int)manifest.names.size(), (int)workers.size());
+}
+
+
+ValidatorNodelet::~ValidatorNodelet(){
+  {
+    std::lock_guard<std::mutex> lock(jobMutex);
+    quit = true;
+    jobQueued.notify_all();
+  }
+  for (int i = 0; i < workers.size(); i++){
+    workers[i].join();
+  }
+  for (int i = 0; i < jobs.size(); i++){  //nobody waits for ever
+    decided(*jobs[i].state, jobs[i].hypothesis, -1);
+  }
+  delete pool;
+}
+
+
+/* Splits a batch into hypotheses for the workers. Returns false (and queues nothing) if the arrays don't fit together */
+bool ValidatorNodelet::queueBatch(std::shared_ptr<BatchState> state, const std::vector<uint32_t> &objects,
+                                  const std::vector<int32_t> &handles, const std::vector<double> &poses){
+  size_t total = 0;
+  for (int h = 0; h < objects.size(); h++){
+    total += objects[h];
+  }
+  if (total != handles.size() || poses.size() != 7 * handles.size()){
+    return false;
+  }
+  state->remaining = objects.size();
+  std::lock_guard<std::mutex> lock(jobMutex);
+  size_t first = 0;
+  for (int h = 0; h < objects.size(); h++){
+    HypothesisJob job = {state, h, (int)objects[h], handles.data() + first, poses.data() + 7*first};
+    jobs.push_back(job);
+    first += objects[h];
+  }
+  jobQueued.notify_all();
+  return true;
+}
+
+
+/* a topic batch, its verdicts are published one by one */
+void ValidatorNodelet::batchReceived(const SceneBatch::ConstPtr &batch){
+  std::shared_ptr<BatchState> state(new BatchState());
+  state->batch = batch;
+  state->batchId = batch->batch_id;
+  state->verdicts = 0;
+  if (!queueBatch(state, batch->objects, batch->handles, batch->poses)){
+    NODELET_ERROR("SceneBatch %u: objects, handles and poses (7 per object) don't fit together", batch->batch_id);
+    state->remaining = batch->objects.size();
+    for (int h = 0; h < batch->objects.size(); h++){
+      decided(*state, h, -1);
+    }
+  }
+}
+
+
+/* a service call, answered when every hypothesis is decided */
+bool ValidatorNodelet::validateScenes(ValidateScenes::Request &request, ValidateScenes::Response &response){
+  response.verdicts.assign(request.objects.size(), -1);
+  std::shared_ptr<BatchState> state(new BatchState());
+  state->batchId = 0;
+  state->verdicts = &response.verdicts;
+  if (request.objects.empty()){
+    return true;
+  }
+  if (!queueBatch(state, request.objects, request.handles, request.poses)){
+    NODELET_ERROR("validate_scenes: objects, handles and poses (7 per object) don't fit together");
+    return true;  //every verdict is -1
+  }
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&state]{ return state->remaining.load() == 0; });
+  return true;
+}
+
+
+bool ValidatorNodelet::getModels(GetModels::Request &request, GetModels::Response &response){
+  response.names = manifest.names;
+  return true;
+}
+
+
+/* hands a verdict to whoever is waiting for it */
+void ValidatorNodelet::decided(BatchState &state, int hypothesis, int verdict){
+  if (state.verdicts){
+    (*state.verdicts)[hypothesis] = verdict;
+    if (--state.remaining == 0){
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.finished.notify_all();
+    }
+  } else {
+    SceneVerdict::Ptr message(new SceneVerdict());  //published as a shared pointer, so it isn't serialised within the manager
+    message->batch_id = state.batchId;
+    message->hypothesis = hypothesis;
+    message->verdict = verdict;
+    message->remaining = --state.remaining;
+    verdicts.publish(message);
+  }
+}
+
+
+/* a worker thread */
+void ValidatorNodelet::work(){
+  SceneValidator *validator = pool->checkout(manifest.names, manifest.files, manifest.scales);  //already holds the models
+  std::vector<ModelPose> scene;
+  std::vector<bool> used(manifest.names.size());
+  while (true){
+    HypothesisJob job;
+    {
+      std::unique_lock<std::mutex> lock(jobMutex);
+      jobQueued.wait(lock, [this]{ return quit || !jobs.empty(); });
+      if (quit){
+        break;
+      }
+      job = jobs.front();
+      jobs.pop_front();
+    }
+
+    //straight from the message's arrays into ModelPose, a bad or repeated handle makes the hypothesis malformed
+    bool good = job.count > 0;
+    scene.resize(job.count);
+    std::fill(used.begin(), used.end(), false);
+    for (int i = 0; i < job.count && good; i++){
+      int handle = job.handles[i];
+      good = handle >= 0 && handle < used.size() && !used[handle];
+      if (!good) break;
+      used[handle] = true;
+      scene[i].handle = handle;
+      for (int k = 0; k < 3; k++) scene[i].position[k] = job.poses[7*i + k];
+      for (int k = 0; k < 4; k++) scene[i].quaternion[k] = job.poses[7*i + 3 + k];
+    }
+    int verdict = good ? validator->isValidScene(scene.data(), job.count) : -1;
+    decided(*job.state, job.hypothesis, verdict);
+  }
+  pool->checkin(validator);
+}
+
+}  //namespace scenevalidator
+
+PLUGINLIB_EXPORT_CLASS(scenevalidator::ValidatorNodelet, nodelet::Nodelet)
@@ -0,0 +1,39 @@
+/****************************************************
+  Description:  Parses and prepares the models of a manifest (see modelManifest.h) once and writes them to a model store
+                (see modelStore.h).  Validators given the store instead of the .obj files map it read-only, so when
+                several validator processes run on one machine (the daemon's worker processes, a ShardedValidator or
+                separate programs) the trimeshes are in memory once.  Point a manifest at the store with lines like
+                    model red_mug tabletop.svstore
+
+                Usage: buildModelStore <manifest> <store.svstore>
+****************************************************/
+
+#include "sceneValidator.h"
+#include "modelManifest.h"
+#include <iostream>
+using namespace std;
+
+
+int main (int argc, char **argv)
+{
+  if (argc < 3){
+    cout<<"Usage: buildModelStore <manifest> <store.svstore>"<<endl;
+    return 1;
+  }
+  ModelManifest manifest;
+  if (!manifest.read(argv[1]) || manifest.names.empty()){
+    cout<<"***ERROR*** in buildModelStore. "<<argv[1]<<" has no models"<<endl;
+    return 1;
+  }
+  SceneValidator *validator = new SceneValidator();
+  for (int i = 0; i < manifest.scales.size(); i++){
+    if (manifest.scales[i] > 0) validator->setScale(i, manifest.scales[i]);
+  }
+  validator->setModels(manifest.names, manifest.files);
+  bool saved = validator->saveModelStore(argv[2]);
+  delete validator;
+  if (saved){
+    cout<<"Wrote "<<manifest.names.size()<<" models to "<<argv[2]<<endl;
+  }
+  return saved ? 0 : 1;
+}
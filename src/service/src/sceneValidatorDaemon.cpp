@@ -0,0 +1,282 @@
+/****************************************************
+  Description:  A daemon which loads the models of a manifest (see modelManifest.h) once and checks scenes for every
+                process on the machine, so the perception node, the grasp planner and anything else don't each load their
+                own copy of every model.  Clients (see validationClient.h) send (handle, pose) arrays over a Unix domain
+                socket.  Requests arriving within BATCH_WINDOW microseconds of each other are gathered and split evenly
+                between the workers, each a SceneValidator from a ValidatorPool with every model loaded, so gathering
+                never leaves a worker idle while another has several requests queued.
+                The verdicts go back on each request's own connection as soon as they are known.
+                With "processes" at the end the workers are processes of a ShardedValidator instead of threads, for
+                ODE builds which aren't safe to use from several threads, and a crash only loses the scene that caused it.
+
+                Usage: sceneValidatorDaemon <manifest> [socket path] [workers] [batch window in microseconds] [processes]
+****************************************************/
+
+#include "sceneValidator.h"
+#include "modelManifest.h"
+#include "validationProtocol.h"
+#include "shardedValidator.h"
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+using namespace std;
+
+#define WORKERS 4          // default number of workers
+#define BATCH_WINDOW 500   // default microseconds a batch waits for more requests after its first one arrived
+#define BATCH_MAX 32       // most requests gathered at once, a full gathering goes out without waiting
+
+
+/* a client's connection, closed when the reader and every request from it are done with it */
+struct Connection {
+  int fd;
+  std::mutex writing;      //replies come from several workers
+  Connection(int fd) : fd(fd) {}
+  ~Connection() { close(fd); }
+};
+
+/* a scene waiting for a worker */
+struct Request {
+  shared_ptr<Connection> connection;
+  uint32_t id;
+  vector<ModelPose> poses;
+  chrono::steady_clock::time_point arrived;
+};
+
+static std::mutex queueMutex;
+static std::condition_variable requestArrived, batchReady;
+static deque<Request> pending;                  //requests not in a batch yet
+static deque< vector<Request> > batches;        //batches waiting for a worker
+static vector<string> modelNames;               //handle order
+static chrono::microseconds window(BATCH_WINDOW);
+static string socketPath = SV_SOCKET_PATH;
+static ValidatorPool *pool;                     //the workers' validators, every one holds all the models
+static int workers = WORKERS;                   //worker threads, or worker processes with "processes"
+static ShardedValidator *sharded = 0;           //the worker processes, when the daemon runs with "processes"
+static ModelManifest manifest;
+
+
+/* sends a verdict back */
+static void reply(Connection &connection, uint32_t id, int verdict){
+  FrameHeader header = {SV_MAGIC, SV_SCENE, id, verdict};
+  std::lock_guard<std::mutex> lock(connection.writing);
+  writeAll(connection.fd, &header, sizeof(header));
+}
+
+
+/* sends the model names, in handle order */
+static bool sendModels(Connection &connection, uint32_t id){
+  std::lock_guard<std::mutex> lock(connection.writing);
+  FrameHeader header = {SV_MAGIC, SV_MODELS, id, (int32_t)modelNames.size()};
+  if (!writeAll(connection.fd, &header, sizeof(header))){
+    return false;
+  }
+  for (int i = 0; i < modelNames.size(); i++){
+    uint32_t length = modelNames[i].size();
+    if (!writeAll(connection.fd, &length, 4) || !writeAll(connection.fd, modelNames[i].data(), length)){
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/* reads a client's requests until it disconnects or sends something that isn't a frame */
+static void readRequests(shared_ptr<Connection> connection){
+  vector<char> payload;
+  FrameHeader header;
+  while (readAll(connection->fd, &header, sizeof(header)) && header.magic == SV_MAGIC){
+    if (header.type == SV_MODELS){
+      if (!sendModels(*connection, header.id)) break;
+    } else if (header.type == SV_SCENE && header.count >= 0 && header.count <= SV_MAX_OBJECTS){
+      Request request;
+      request.connection = connection;
+      request.id = header.id;
+      request.poses.resize(header.count);
+      payload.resize(header.count * POSE_BYTES);
+      if (header.count > 0 && !readAll(connection->fd, &payload[0], payload.size())) break;
+      unpackPoses(payload.data(), header.count, request.poses.data());
+      request.arrived = chrono::steady_clock::now();
+      std::lock_guard<std::mutex> lock(queueMutex);
+      pending.push_back(std::move(request));
+      requestArrived.notify_one();
+    } else {
+      break;
+    }
+  }
+  shutdown(connection->fd, SHUT_RD);  //queued requests still get their replies
+}
+
+
+/* Gathers the requests arriving within the window and splits them into one batch per worker thread. With worker
+   processes the whole gathering is one batch, ShardedValidator spreads it over the processes itself */
+static void gatherBatches(){
+  std::unique_lock<std::mutex> lock(queueMutex);
+  while (true){
+    requestArrived.wait(lock, []{ return !pending.empty(); });
+    requestArrived.wait_until(lock, pending.front().arrived + window, []{ return pending.size() >= BATCH_MAX; });
+    int gathered = std::min((int)pending.size(), BATCH_MAX);
+    int share = sharded ? gathered : (gathered + workers - 1) / workers;
+    while (gathered > 0){
+      vector<Request> batch;
+      while (batch.size() < share && gathered > 0){
+        batch.push_back(std::move(pending.front()));
+        pending.pop_front();
+        gathered--;
+      }
+      batches.push_back(std::move(batch));
+      batchReady.notify_one();
+    }
+  }
+}
+
+
+/* a worker, checks the batches with its own validator */
+static void checkBatches(){
+  //checked out in this thread so ODE's data for it is made, the validator already holds the models
+  SceneValidator *validator = pool->checkout(manifest.names, manifest.files, manifest.scales);
+  vector<bool> used(modelNames.size());
+  while (true){
+    vector<Request> batch;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      batchReady.wait(lock, []{ return !batches.empty(); });
+      batch = std::move(batches.front());
+      batches.pop_front();
+    }
+    for (int r = 0; r < batch.size(); r++){
+      Request &request = batch[r];
+      //a bad handle or one used twice is the client's mistake, it gets -1 rather than a verdict
+      bool good = !request.poses.empty();
+      std::fill(used.begin(), used.end(), false);
+      for (int i = 0; i < request.poses.size() && good; i++){
+        int handle = request.poses[i].handle;
+        good = handle >= 0 && handle < used.size() && !used[handle];
+        if (good) used[handle] = true;
+      }
+      int verdict = good ? validator->isValidScene(request.poses.data(), request.poses.size()) : -1;
+      reply(*request.connection, request.id, verdict);
+    }
+  }
+}
+
+
+/* the only worker thread when the workers are processes, it sends each whole batch to them */
+static void shardBatches(){
+  while (true){
+    vector<Request> batch;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      batchReady.wait(lock, []{ return !batches.empty(); });
+      batch = std::move(batches.front());
+      batches.pop_front();
+    }
+    vector< vector<ModelPose> > scenes(batch.size());
+    for (int r = 0; r < batch.size(); r++){
+      scenes[r].swap(batch[r].poses);
+    }
+    vector<int> verdicts = sharded->isValidScenes(scenes);  //bad handles get -1 here too
+    for (int r = 0; r < batch.size(); r++){
+      reply(*batch[r].connection, batch[r].id, verdicts[r]);
+    }
+  }
+}
+
+
+/* removes the socket file when the daemon is stopped */
+static void stop(int signal){
+  unlink(socketPath.c_str());
+  _exit(0);
+}
+
+
+int main (int argc, char **argv)
+{
+  if (argc < 2){
+    cout<<"Usage: sceneValidatorDaemon <manifest> [socket path] [workers] [batch window in microseconds] [processes]"<<endl;
+    return 1;
+  }
+  if (!manifest.read(argv[1]) || manifest.names.empty()){
+    cout<<"***ERROR*** in sceneValidatorDaemon. "<<argv[1]<<" has no models"<<endl;
+    return 1;
+  }
+  if (argc > 2) socketPath = argv[2];
+  if (argc > 3) workers = atoi(argv[3]);
+  if (argc > 4) window = chrono::microseconds(atoi(argv[4]));
+  if (workers < 1) workers = 1;
+  bool processes = argc > 5 && string(argv[5]) == "processes";
+  modelNames = manifest.names;
+
+  if (processes){
+    //forked before any thread is started, with the manifest's parameters
+    SceneValidator *validator = new SceneValidator();
+    for (int i = 0; i < manifest.params.size(); i++){
+      validator->setParams(manifest.params[i].first, manifest.params[i].second);
+    }
+    delete validator;
+    sharded = new ShardedValidator(workers, manifest.names, manifest.files, manifest.scales);
+  } else {
+    //load the models once per worker, from here on nothing is loaded
+    pool = new ValidatorPool(workers);
+    vector<SceneValidator*> validators;
+    for (int i = 0; i < workers; i++){
+      validators.push_back(pool->checkout(manifest.names, manifest.files, manifest.scales));
+    }
+    for (int i = 0; i < manifest.params.size(); i++){  //parameters are shared by every SceneValidator
+      validators[0]->setParams(manifest.params[i].first, manifest.params[i].second);
+    }
+    for (int i = 0; i < workers; i++){
+      pool->checkin(validators[i]);
+    }
+  }
+
+  //listen on the socket
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)){
+    cout<<"***ERROR*** in sceneValidatorDaemon. The socket path "<<socketPath<<" is too long"<<endl;
+    return 1;
+  }
+  strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+  unlink(socketPath.c_str());  //left over from a daemon which didn't stop cleanly
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 64) < 0){
+    cout<<"***ERROR*** in sceneValidatorDaemon. Couldn't listen at "<<socketPath<<endl;
+    return 1;
+  }
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  signal(SIGPIPE, SIG_IGN);
+
+  std::thread(gatherBatches).detach();
+  if (processes){
+    std::thread(shardBatches).detach();
+  } else {
+    for (int i = 0; i < workers; i++){
+      std::thread(checkBatches).detach();
+    }
+  }
+  cout<<"Checking scenes of "<<modelNames.size()<<" models at "<<socketPath<<" with "<<workers<<" worker "<<(processes ? "processes" : "threads")<<endl;
+
+  while (true){
+    int client = accept(listener, 0, 0);
+    if (client < 0){
+      continue;
+    }
+    std::thread(readRequests, make_shared<Connection>(client)).detach();
+  }
+  return 0;
+}
@@ -0,0 +1,330 @@
+/****************************************************
+  Description:  Checks every scene of a scene file offline, for replaying logged hypotheses while tuning parameters without
+                writing a new main().  The models and parameters come from a manifest (see modelManifest.h).  The scenes
+                are read as they're needed and checked by workers, each a SceneValidator from a ValidatorPool, so the whole
+                file is never in memory.  A scene file is either
+                  - JSON lines (a name ending in .jsonl), one scene per line, each object written as
+                        {"model": "red_mug", "pose": [x, y, z, qw, qx, qy, qz]}
+                    anywhere in the line, for example [{"model": ...}, {"model": ...}]
+                  - binary (any other name), memory-mapped. Every scene is an int32 count followed by count poses in the
+                    daemon's wire form (int32 handle, then 3 position and 4 quaternion doubles, packed, see
+                    validationProtocol.h). Handles are the positions of the models in the manifest.
+                The results file gets one line per scene, in the order of the scene file:
+                    <scene> <verdict> <max displacement> <milliseconds>
+                verdict is 1 valid, 0 invalid, -1 undecided (the budget ran out) or a scene which couldn't be read.
+                A throughput summary is printed at the end.
+
+                Usage: validateSceneFile <manifest> <scene file> <results file> [workers] [budget in milliseconds]
+****************************************************/
+
+#include "sceneValidator.h"
+#include "modelManifest.h"
+#include "validationProtocol.h"
+#include <map>
+#include <deque>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <condition_variable>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+#define WORKERS 4              // default number of workers
+#define QUEUE_SCENES 256       // most scenes read but not yet taken by a worker
+#define RESULT_WINDOW 4096     // most scenes checked but not yet written (they wait for a slower scene before them)
+#define RELEASE_BYTES (64 << 20)  // binary scene file pages already read are given back every RELEASE_BYTES
+
+
+/* a scene waiting for a worker */
+struct Scene {
+  long index;
+  bool good;                   //false if it couldn't be read, it gets -1 without being checked
+  vector<ModelPose> poses;
+};
+
+/* what happened to one scene */
+struct Result {
+  int verdict;
+  double displacement;
+  double milliseconds;
+};
+
+static std::mutex queueMutex;
+static std::condition_variable sceneQueued, sceneTaken;
+static deque<Scene> queued;
+static bool allRead = false;
+static map<long, Result> checked;           //results waiting for the scenes before them
+static long written = 0;                    //scenes written to the results file
+static FILE *results;
+static ValidatorPool *pool;
+static ModelManifest manifest;
+static SceneBudget budget;
+
+//for the summary
+static long valid = 0, invalid = 0, undecided = 0;
+static double totalMilliseconds = 0, slowestMilliseconds = 0;
+
+
+/* hands a scene to the workers, waiting while too many are queued or waiting to be written */
+static void queueScene(Scene &scene){
+  std::unique_lock<std::mutex> lock(queueMutex);
+  sceneTaken.wait(lock, [&]{ return queued.size() < QUEUE_SCENES && scene.index - written < RESULT_WINDOW; });
+  queued.push_back(std::move(scene));
+  sceneQueued.notify_one();
+}
+
+
+/* keeps a result and writes every result which is no longer waiting for an earlier scene */
+static void finishScene(long index, Result result){
+  std::lock_guard<std::mutex> lock(queueMutex);
+  checked[index] = result;
+  while (!checked.empty() && checked.begin()->first == written){
+    const Result &r = checked.begin()->second;
+    fprintf(results, "%ld %d %.6g %.3f\n", written, r.verdict, r.displacement, r.milliseconds);
+    valid += r.verdict == 1;
+    invalid += r.verdict == 0;
+    undecided += r.verdict == -1;
+    totalMilliseconds += r.milliseconds;
+    slowestMilliseconds = std::max(slowestMilliseconds, r.milliseconds);
+    checked.erase(checked.begin());
+    written++;
+  }
+  sceneTaken.notify_one();
+}
+
+
+/* a worker, checks queued scenes with its own validator until the file is read and the queue is empty */
+static void checkScenes(){
+  //checked out in this thread so ODE's data for it is made, the validator already holds the models
+  SceneValidator *validator = pool->checkout(manifest.names, manifest.files, manifest.scales);
+  vector<string> modelnames;
+  vector<Eigen::Affine3d> model_poses;
+  vector<bool> used(manifest.names.size());
+  while (true){
+    Scene scene;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      sceneQueued.wait(lock, []{ return !queued.empty() || allRead; });
+      if (queued.empty()) break;
+      scene = std::move(queued.front());
+      queued.pop_front();
+      sceneTaken.notify_one();
+    }
+    //a bad handle or one used twice is the scene file's mistake, it gets -1 rather than a verdict
+    std::fill(used.begin(), used.end(), false);
+    for (int i = 0; i < scene.poses.size() && scene.good; i++){
+      int handle = scene.poses[i].handle;
+      scene.good = handle >= 0 && handle < used.size() && !used[handle];
+      if (scene.good) used[handle] = true;
+    }
+    Result result = {-1, 0, 0};
+    if (scene.good && !scene.poses.empty()){
+      modelnames.resize(scene.poses.size());
+      model_poses.resize(scene.poses.size());
+      for (int i = 0; i < scene.poses.size(); i++){
+        const ModelPose &p = scene.poses[i];
+        modelnames[i] = manifest.names[p.handle];
+        Eigen::Quaterniond q(p.quaternion[0], p.quaternion[1], p.quaternion[2], p.quaternion[3]);
+        model_poses[i] = Eigen::Translation3d(Eigen::Vector3d(p.position[0], p.position[1], p.position[2])) * Eigen::Affine3d(q.normalized());
+      }
+      auto start = chrono::steady_clock::now();
+      SceneVerdict verdict = validator->isValidScene(modelnames, model_poses, budget);
+      result.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+      result.verdict = verdict.verdict;
+      result.displacement = verdict.maxDisplacement;
+    }
+    finishScene(scene.index, result);
+  }
+  pool->checkin(validator);
+}
+
+
+/* Reads one JSON line's objects. Only the "model" and "pose" keys are looked at, so the rest of the line can hold
+   anything (an id, a score) as long as it doesn't use those two names */
+static bool parseScene(const string &line, map<string,int> &handles, vector<ModelPose> &poses){
+  poses.clear();
+  size_t at = 0;
+  while ((at = line.find("\"model\"", at)) != string::npos){
+    size_t colon = line.find(':', at + 7);
+    size_t open = colon == string::npos ? colon : line.find('"', colon + 1);
+    size_t close = open == string::npos ? open : line.find('"', open + 1);
+    if (close == string::npos){
+      return false;
+    }
+    map<string,int>::iterator handle = handles.find(line.substr(open + 1, close - open - 1));
+    size_t pose = line.find("\"pose\"", close);
+    size_t bracket = pose == string::npos ? pose : line.find('[', pose);
+    if (handle == handles.end() || bracket == string::npos){
+      return false;
+    }
+    ModelPose p;
+    p.handle = handle->second;
+    const char *c = line.c_str() + bracket + 1;
+    for (int k = 0; k < 7; k++){
+      while (*c == ' ' || *c == ',' || *c == '\t') c++;
+      char *end;
+      double value = strtod(c, &end);
+      if (end == c){
+        return false;
+      }
+      if (k < 3) p.position[k] = value;
+      else p.quaternion[k-3] = value;
+      c = end;
+    }
+    poses.push_back(p);
+    at = c - line.c_str();
+  }
+  return !poses.empty();
+}
+
+
+/* queues the scenes of a JSON lines file, one line at a time. Returns the number of scenes */
+static long readJsonLines(string filename){
+  ifstream file(filename.c_str());
+  if (!file.is_open()){
+    cout<<"***ERROR*** in validateSceneFile. Couldn't open "<<filename<<endl;
+    return -1;
+  }
+  map<string,int> handles;
+  for (int i = 0; i < manifest.names.size(); i++){
+    handles[manifest.names[i]] = i;
+  }
+  string line;
+  long index = 0;
+  while (getline(file, line)){
+    if (line.find_first_not_of(" \t\r") == string::npos){
+      continue;
+    }
+    Scene scene;
+    scene.index = index++;
+    scene.good = parseScene(line, handles, scene.poses);
+    if (!scene.good){
+      cout<<"***ERROR*** in validateSceneFile. Scene "<<scene.index<<" ("<<line.substr(0, 60)<<") isn't a list of models and poses"<<endl;
+    }
+    queueScene(scene);
+  }
+  return index;
+}
+
+
+/* queues the scenes of a binary scene file, mapped read-only. Pages already read are given back as it goes, so a file
+   larger than memory can be checked. Returns the number of scenes */
+static long readBinary(string filename){
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) < 0){
+    cout<<"***ERROR*** in validateSceneFile. Couldn't open "<<filename<<endl;
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+  size_t size = info.st_size;
+  if (size == 0){
+    close(fd);
+    return 0;
+  }
+  char *data = (char*)mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED){
+    cout<<"***ERROR*** in validateSceneFile. Couldn't map "<<filename<<endl;
+    return -1;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+  size_t at = 0, released = 0;
+  long index = 0;
+  while (at + 4 <= size){
+    int32_t count;
+    memcpy(&count, data + at, 4);
+    if (count < 0 || count > SV_MAX_OBJECTS || at + 4 + (size_t)count * POSE_BYTES > size){
+      cout<<"***ERROR*** in validateSceneFile. Scene "<<index<<" at byte "<<at<<" of "<<filename<<" is cut off or has "<<count<<" objects"<<endl;
+      break;
+    }
+    Scene scene;
+    scene.index = index++;
+    scene.good = count > 0;
+    scene.poses.resize(count);
+    unpackPoses(data + at + 4, count, scene.poses.data());
+    at += 4 + (size_t)count * POSE_BYTES;
+    queueScene(scene);
+    if (at - released >= RELEASE_BYTES){
+      size_t page = sysconf(_SC_PAGESIZE);
+      size_t end = at / page * page;
+      madvise(data + released, end - released, MADV_DONTNEED);
+      released = end;
+    }
+  }
+  munmap(data, size);
+  return index;
+}
+
+
+int main (int argc, char **argv)
+{
+  if (argc < 4){
+    cout<<"Usage: validateSceneFile <manifest> <scene file> <results file> [workers] [budget in milliseconds]"<<endl;
+    return 1;
+  }
+  if (!manifest.read(argv[1]) || manifest.names.empty()){
+    cout<<"***ERROR*** in validateSceneFile. "<<argv[1]<<" has no models"<<endl;
+    return 1;
+  }
+  string sceneFile = argv[2];
+  int workers = argc > 4 ? atoi(argv[4]) : WORKERS;
+  if (workers < 1) workers = 1;
+  if (argc > 5) budget.milliseconds = atof(argv[5]);
+  results = fopen(argv[3], "w");
+  if (!results){
+    cout<<"***ERROR*** in validateSceneFile. Couldn't write "<<argv[3]<<endl;
+    return 1;
+  }
+
+  //load the models once per worker, from here on nothing is loaded
+  pool = new ValidatorPool(workers);
+  vector<SceneValidator*> validators;
+  for (int i = 0; i < workers; i++){
+    validators.push_back(pool->checkout(manifest.names, manifest.files, manifest.scales));
+  }
+  for (int i = 0; i < manifest.params.size(); i++){  //parameters are shared by every SceneValidator
+    validators[0]->setParams(manifest.params[i].first, manifest.params[i].second);
+  }
+  for (int i = 0; i < workers; i++){
+    pool->checkin(validators[i]);
+  }
+
+  auto start = chrono::steady_clock::now();
+  vector<std::thread> threads;
+  for (int i = 0; i < workers; i++){
+    threads.push_back(std::thread(checkScenes));
+  }
+  bool jsonLines = sceneFile.size() >= 6 && sceneFile.compare(sceneFile.size() - 6, 6, ".jsonl") == 0;
+  long scenes = jsonLines ? readJsonLines(sceneFile) : readBinary(sceneFile);
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    allRead = true;
+    sceneQueued.notify_all();
+  }
+  for (int i = 0; i < workers; i++){
+    threads[i].join();
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  fclose(results);
+  delete pool;
+  if (scenes < 0){
+    return 1;
+  }
+
+  cout<<"Checked "<<scenes<<" scenes with "<<workers<<" workers in "<<seconds<<" s: "<<scenes / std::max(seconds, 1e-9)<<" scenes/s"<<endl;
+  cout<<"  valid "<<valid<<", invalid "<<invalid<<", undecided or unreadable "<<undecided<<endl;
+  cout<<"  mean "<<totalMilliseconds / std::max(scenes, 1L)<<" ms per scene, slowest "<<slowestMilliseconds<<" ms"<<endl;
+  cout<<"  results in "<<argv[3]<<endl;
+  return 0;
+}
@@ -0,0 +1,201 @@
+/****************************************************/
+//Description:  Incremental 3D convex hull.  Start from a tetrahedron, then add one point at a time: remove every
+//              triangle the point can "see" and connect the point to the edge of the hole (the horizon).
+//              O(points * triangles), which is fine since hulls are only built once per model when it's loaded.
+/****************************************************/
+
+#include "convexHull.h"
+#include <set>                    //used to find the horizon edges
+#include <cmath>                  //used for sqrt and cos
+#include <utility>                //used for std::pair
+#include <algorithm>              //used for sort and unique
+
+using namespace std;
+
+
+/* a triangle of the hull while it is being built */
+struct HullFace {
+  int v[3];                 //vertex indices, counter clockwise from outside
+  Eigen::Vector3d normal;   //outward unit normal
+  double offset;            //normal.dot(any vertex of the face)
+};
+
+
+/* makes a face from 3 points, oriented so that "inside" is behind it */
+static HullFace makeFace(const vector<Eigen::Vector3d> &points, int a, int b, int c, const Eigen::Vector3d &inside){
+  HullFace face;
+  face.v[0] = a;  face.v[1] = b;  face.v[2] = c;
+  face.normal = (points[b] - points[a]).cross(points[c] - points[a]).normalized();
+  face.offset = face.normal.dot(points[a]);
+  if (face.normal.dot(inside) > face.offset){  //wrong way around, flip it
+    std::swap(face.v[1], face.v[2]);
+    face.normal = -face.normal;
+    face.offset = -face.offset;
+  }
+  return face;
+}
+
+
+/* builds the hull of points */
+bool buildConvexHull(const vector<Eigen::Vector3d> &points, ConvexHull &hull){
+  hull = ConvexHull();
+  int n = points.size();
+  if (n < 4){
+    return false;
+  }
+
+  //tolerance relative to the size of the point cloud
+  Eigen::Vector3d lo = points[0], hi = points[0];
+  for (int i = 1; i < n; i++){
+    lo = lo.cwiseMin(points[i]);
+    hi = hi.cwiseMax(points[i]);
+  }
+  double eps = 1e-9 * (hi - lo).norm();
+
+  //starting tetrahedron: two far apart points, then the point furthest from their line, then the point furthest from that plane
+  int i0 = 0, i1 = 0, i2 = -1, i3 = -1;
+  for (int i = 0; i < n; i++){
+    if (points[i][0] < points[i0][0]) i0 = i;
+  }
+  for (int i = 0; i < n; i++){
+    if ((points[i] - points[i0]).squaredNorm() > (points[i1] - points[i0]).squaredNorm()) i1 = i;
+  }
+  Eigen::Vector3d axis = (points[i1] - points[i0]).normalized();
+  double best = eps;
+  for (int i = 0; i < n; i++){
+    double d = (points[i] - points[i0]).cross(axis).norm();
+    if (d > best){ best = d;  i2 = i; }
+  }
+  if (i2 < 0){
+    return false;
+  }
+  Eigen::Vector3d planeNormal = (points[i1] - points[i0]).cross(points[i2] - points[i0]).normalized();
+  best = eps;
+  for (int i = 0; i < n; i++){
+    double d = std::abs(planeNormal.dot(points[i] - points[i0]));
+    if (d > best){ best = d;  i3 = i; }
+  }
+  if (i3 < 0){
+    return false;
+  }
+
+  Eigen::Vector3d inside = (points[i0] + points[i1] + points[i2] + points[i3]) / 4;
+  vector<HullFace> faces;
+  faces.push_back(makeFace(points, i0, i1, i2, inside));
+  faces.push_back(makeFace(points, i0, i1, i3, inside));
+  faces.push_back(makeFace(points, i0, i2, i3, inside));
+  faces.push_back(makeFace(points, i1, i2, i3, inside));
+
+  //add the rest of the points one at a time
+  for (int p = 0; p < n; p++){
+    if (p == i0 || p == i1 || p == i2 || p == i3) continue;
+
+    //directed edges of all faces which can see the point
+    set< pair<int,int> > visibleEdges;
+    vector<HullFace> kept;
+    for (int f = 0; f < faces.size(); f++){
+      if (faces[f].normal.dot(points[p]) - faces[f].offset > eps){
+        visibleEdges.insert(make_pair(faces[f].v[0], faces[f].v[1]));
+        visibleEdges.insert(make_pair(faces[f].v[1], faces[f].v[2]));
+        visibleEdges.insert(make_pair(faces[f].v[2], faces[f].v[0]));
+      } else {
+        kept.push_back(faces[f]);
+      }
+    }
+    if (visibleEdges.empty()) continue;  //point is inside the hull
+
+    //an edge is on the horizon if the face on its other side is not visible, connect those edges to the new point
+    for (set< pair<int,int> >::iterator e = visibleEdges.begin(); e != visibleEdges.end(); ++e){
+      if (visibleEdges.count(make_pair(e->second, e->first)) == 0){
+        kept.push_back(makeFace(points, e->first, e->second, p, inside));
+      }
+    }
+    faces.swap(kept);
+  }
+
+  //copy out only the points which ended up as corners
+  vector<int> remap(n, -1);
+  for (int f = 0; f < faces.size(); f++){
+    for (int k = 0; k < 3; k++){
+      int v = faces[f].v[k];
+      if (remap[v] < 0){
+        remap[v] = hull.vertices.size();
+        hull.vertices.push_back(points[v]);
+      }
+      hull.triangles.push_back(remap[v]);
+    }
+    hull.normals.push_back(faces[f].normal);
+    hull.offsets.push_back(faces[f].offset);
+  }
+  return true;
+}
+
+
+/* keeps the furthest point along each of numDirections directions spread over a sphere (Fibonacci sphere) */
+vector<Eigen::Vector3d> extremePoints(const vector<Eigen::Vector3d> &points, int numDirections){
+  if (points.size() <= numDirections){
+    return points;
+  }
+  vector<bool> used(points.size(), false);
+  vector<Eigen::Vector3d> result;
+  const double golden = M_PI * (3 - std::sqrt(5.0));
+  for (int d = 0; d < numDirections; d++){
+    double z = 1 - 2 * (d + 0.5) / numDirections;
+    double r = std::sqrt(1 - z*z);
+    Eigen::Vector3d dir(r * std::cos(golden*d), r * std::sin(golden*d), z);
+    int furthest = 0;
+    for (int i = 1; i < points.size(); i++){
+      if (dir.dot(points[i]) > dir.dot(points[furthest])) furthest = i;
+    }
+    if (!used[furthest]){
+      used[furthest] = true;
+      result.push_back(points[furthest]);
+    }
+  }
+  return result;
+}
+
+
+/* > 0 when o, a, b turn counter clockwise */
+static double cross2D(const pair<double,double> &o, const pair<double,double> &a, const pair<double,double> &b){
+  return (a.first - o.first) * (b.second - o.second) - (a.second - o.second) * (b.first - o.first);
+}
+
+
+/* 2D hull with Andrew's monotone chain, then the distance to the closest edge */
+double polygonMargin(const vector<double> &points, double px, double py){
+  int n = points.size()/2;
+  vector< pair<double,double> > p(n);
+  for (int i = 0; i < n; i++){
+    p[i] = make_pair(points[2*i], points[2*i+1]);
+  }
+  sort(p.begin(), p.end());
+  p.erase(unique(p.begin(), p.end()), p.end());
+  n = p.size();
+  if (n < 3){
+    return -1e300;
+  }
+  vector< pair<double,double> > hull(2*n);
+  int k = 0;
+  for (int j = 0; j < n; j++){  //lower hull left to right
+    while (k >= 2 && cross2D(hull[k-2], hull[k-1], p[j]) <= 0) k--;
+    hull[k++] = p[j];
+  }
+  for (int j = n-2, lower = k+1; j >= 0; j--){  //upper hull right to left
+    while (k >= lower && cross2D(hull[k-2], hull[k-1], p[j]) <= 0) k--;
+    hull[k++] = p[j];
+  }
+  k--;  //the last point is the first one again
+  if (k < 3){
+    return -1e300;
+  }
+  double margin = 1e300;
+  for (int i = 0; i < k; i++){  //counter clockwise, so inside is to the left of every edge
+    const pair<double,double> &a = hull[i];
+    const pair<double,double> &b = hull[(i+1) % k];
+    double ex = b.first - a.first, ey = b.second - a.second;
+    double length = std::sqrt(ex*ex + ey*ey);
+    margin = min(margin, (ex * (py - a.second) - ey * (px - a.first)) / length);
+  }
+  return margin;
+}
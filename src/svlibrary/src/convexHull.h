@@ -0,0 +1,32 @@
+/****************************************************/
+//Description:  Convex hulls of a model's vertices.  A hull is a much simpler collision shape than the scanned trimesh
+//              and is used wherever a model only needs to be roughly right (e.g. the built in impulse backend).
+/****************************************************/
+
+#include <vector>
+#include <Eigen/Dense>
+#ifndef CONVEXHULL_H
+#define CONVEXHULL_H
+
+
+/* A convex polyhedron. Each triangle is 3 indices into vertices, counter clockwise when seen from outside.
+   Every triangle also has its outward unit normal and offset, so a point p is inside when normals[i].dot(p) <= offsets[i] for all i */
+struct ConvexHull {
+    std::vector<Eigen::Vector3d> vertices;   //corners of the hull
+    std::vector<int> triangles;              //3 vertex indices per triangle
+    std::vector<Eigen::Vector3d> normals;    //outward normal of each triangle
+    std::vector<double> offsets;             //plane offset of each triangle
+};
+
+/* Builds the convex hull of points.  Returns false if the points are (nearly) flat and have no hull */
+bool buildConvexHull(const std::vector<Eigen::Vector3d> &points, ConvexHull &hull);
+
+/* Keeps only the points which are furthest along one of numDirections evenly spread directions.
+   The hull of the result is a good approximation of the full hull with at most numDirections corners */
+std::vector<Eigen::Vector3d> extremePoints(const std::vector<Eigen::Vector3d> &points, int numDirections);
+
+/* Signed distance from (px,py) to the edge of the 2D convex hull of points (x0,y0,x1,y1...), positive inside.
+   Returns -1e300 if the points don't enclose any area (fewer than 3, or all on a line) */
+double polygonMargin(const std::vector<double> &points, double px, double py);
+
+#endif
@@ -0,0 +1,473 @@
+/****************************************************/
+//Description:  Sequential impulse backend.  Each step:
+//                1. generateContacts(): every hull corner that is below the ground plane or inside another body's
+//                   hull becomes a contact, with the normal of the face it is closest to leaving through
+//                2. step(): gravity is added to the velocities, then the contacts are visited `iterations` times,
+//                   each time applying just enough impulse to stop the bodies approaching (plus a little to push
+//                   penetrating bodies apart), with friction impulses clamped to the friction cone
+//                3. positions and rotations are moved along the new velocities
+//              Corners only (no edge-edge contacts) is fine for objects resting on the ground and on each other,
+//              which is the case this backend is tuned for.
+/****************************************************/
+
+#include "impulseBackend.h"
+#include <algorithm>              //used for std::sort, std::find, std::min and std::max
+#include <cmath>                  //used for sqrt
+
+using namespace std;
+
+static const double BAUMGARTE = 0.2;       //fraction of the penetration corrected per step
+static const double SLOP = 0.005;          //penetration allowed without correcting it, stops resting contacts from jittering
+static const double DAMPING = 0.02;        //a little velocity damping per second, helps objects settle
+
+
+/* mass and inertia (about the origin, which is the center of mass) of a closed triangle mesh.
+   Each triangle and the origin make a tetrahedron, and the tetrahedrons' volume integrals are summed */
+static void meshMassProperties(const float *vertices, const int *indices, int triCount, double density,
+                               double &mass, Eigen::Matrix3d &inertia){
+  double volume = 0;
+  Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();  //integral of x*x^T over the volume
+  for (int t = 0; t < triCount; t++){
+    Eigen::Vector3d a(vertices[3*indices[3*t]],   vertices[3*indices[3*t]+1],   vertices[3*indices[3*t]+2]);
+    Eigen::Vector3d b(vertices[3*indices[3*t+1]], vertices[3*indices[3*t+1]+1], vertices[3*indices[3*t+1]+2]);
+    Eigen::Vector3d c(vertices[3*indices[3*t+2]], vertices[3*indices[3*t+2]+1], vertices[3*indices[3*t+2]+2]);
+    double v = a.dot(b.cross(c)) / 6;
+    Eigen::Vector3d s = a + b + c;
+    volume += v;
+    covariance += v / 20 * (a*a.transpose() + b*b.transpose() + c*c.transpose() + s*s.transpose());
+  }
+  if (volume < 0){  //faces wound the other way
+    volume = -volume;
+    covariance = -covariance;
+  }
+  mass = density * volume;
+  inertia = density * (covariance.trace() * Eigen::Matrix3d::Identity() - covariance);
+}
+
+
+ImpulseBackend::ImpulseBackend(){
+  gravity = Eigen::Vector3d(0, 0, -0.5);
+  planeNormal = Eigen::Vector3d(0, 0, 1);
+  planeOffset = 0;
+}
+
+
+PhysicsBackend* ImpulseBackend::emptyCopy() const{
+  return new ImpulseBackend();
+}
+
+
+int ImpulseBackend::createBody(const float *vertices, int vertCount, const int *indices, int triCount, double density){
+  ImpulseBody body;
+
+  //collision shape: hull of the extreme points of the mesh
+  vector<Eigen::Vector3d> points(vertCount);
+  for (int i = 0; i < vertCount; i++){
+    points[i] = Eigen::Vector3d(vertices[3*i], vertices[3*i+1], vertices[3*i+2]);
+  }
+  buildConvexHull(extremePoints(points, HULL_POINTS), body.hull);
+
+  //mass from the real mesh, or from the hull if the mesh has no volume (e.g. it has holes)
+  double mass;
+  Eigen::Matrix3d inertia;
+  meshMassProperties(vertices, indices, triCount, density, mass, inertia);
+  if (mass <= 0 || inertia.determinant() <= 0){
+    vector<float> hullVertices;
+    for (int i = 0; i < body.hull.vertices.size(); i++){
+      for (int k = 0; k < 3; k++) hullVertices.push_back(body.hull.vertices[i][k]);
+    }
+    meshMassProperties(hullVertices.data(), body.hull.triangles.data(), body.hull.triangles.size()/3, density, mass, inertia);
+  }
+  body.invMass = mass > 0 ? 1/mass : 0;
+  body.invInertia = mass > 0 ? Eigen::Matrix3d(inertia.inverse()) : Eigen::Matrix3d::Zero();
+
+  body.position.setZero();
+  body.rotation.setIdentity();
+  body.linearVel.setZero();
+  body.angularVel.setZero();
+  body.group = 0;
+  body.enabled = true;
+  body.asleep = false;
+  if (!freeBodies.empty()){  //reuse a destroyed body's slot
+    int handle = freeBodies.back();
+    freeBodies.pop_back();
+    bodies[handle] = body;
+    return handle;
+  }
+  bodies.push_back(body);
+  return bodies.size()-1;
+}
+
+
+void ImpulseBackend::destroyBody(int body){
+  if (std::find(freeBodies.begin(), freeBodies.end(), body) != freeBodies.end()){  //already destroyed
+    return;
+  }
+  ImpulseBody &b = bodies[body];
+  b = ImpulseBody();  //no hull, so nothing collides with it
+  b.invMass = 0;
+  b.invInertia.setZero();
+  b.position.setZero();
+  b.rotation.setIdentity();
+  b.linearVel.setZero();
+  b.angularVel.setZero();
+  b.group = 0;
+  b.enabled = false;
+  b.asleep = false;
+  freeBodies.push_back(body);
+}
+
+
+void ImpulseBackend::setPose(int body, const double position[3], const double R[12]){
+  ImpulseBody &b = bodies[body];
+  b.position = Eigen::Vector3d(position[0], position[1], position[2]);
+  b.rotation << R[0], R[1], R[2],
+                R[4], R[5], R[6],
+                R[8], R[9], R[10];
+  b.linearVel.setZero();
+  b.angularVel.setZero();
+}
+
+
+void ImpulseBackend::getPose(int body, double position[3], double R[12]){
+  const ImpulseBody &b = bodies[body];
+  for (int i = 0; i < 3; i++){
+    position[i] = b.position[i];
+    for (int j = 0; j < 3; j++){
+      R[4*i+j] = b.rotation(i,j);
+    }
+    R[4*i+3] = 0;
+  }
+}
+
+
+double ImpulseBackend::getMass(int body){
+  return bodies[body].invMass > 0 ? 1/bodies[body].invMass : 0;
+}
+
+
+void ImpulseBackend::getVelocity(int body, double linear[3], double angular[3]){
+  for (int i = 0; i < 3; i++){
+    linear[i] = bodies[body].linearVel[i];
+    angular[i] = bodies[body].angularVel[i];
+  }
+}
+
+
+void ImpulseBackend::setCollisionGroup(int body, int group){
+  bodies[body].group = group;
+}
+
+
+void ImpulseBackend::setEnabled(int body, bool enabled){
+  bodies[body].enabled = enabled;
+  bodies[body].asleep = false;
+  bodies[body].linearVel.setZero();
+  bodies[body].angularVel.setZero();
+}
+
+
+void ImpulseBackend::setAsleep(int body){
+  bodies[body].enabled = true;
+  bodies[body].asleep = true;
+  bodies[body].linearVel.setZero();
+  bodies[body].angularVel.setZero();
+}
+
+
+void ImpulseBackend::setGravity(double x, double y, double z){
+  gravity = Eigen::Vector3d(x, y, z);
+}
+
+
+void ImpulseBackend::setGroundPlane(double a, double b, double c, double d){
+  planeNormal = Eigen::Vector3d(a, b, c);
+  planeOffset = d;
+}
+
+
+void ImpulseBackend::configure(const BackendSettings &newSettings){
+  settings = newSettings;
+}
+
+
+/* moves a body's hull into world coordinates */
+void ImpulseBackend::updateWorldHull(ImpulseBody &body){
+  int nv = body.hull.vertices.size();
+  int nf = body.hull.normals.size();
+  body.worldVertices.resize(nv);
+  body.worldNormals.resize(nf);
+  body.worldOffsets.resize(nf);
+  body.aabbMin = body.aabbMax = body.position;
+  for (int i = 0; i < nv; i++){
+    body.worldVertices[i] = body.rotation * body.hull.vertices[i] + body.position;
+    body.aabbMin = body.aabbMin.cwiseMin(body.worldVertices[i]);
+    body.aabbMax = body.aabbMax.cwiseMax(body.worldVertices[i]);
+  }
+  for (int i = 0; i < nf; i++){
+    body.worldNormals[i] = body.rotation * body.hull.normals[i];
+    body.worldOffsets[i] = body.hull.offsets[i] + body.worldNormals[i].dot(body.position);
+  }
+}
+
+
+/* hull corners below the ground plane */
+void ImpulseBackend::collideGround(int body){
+  const ImpulseBody &b = bodies[body];
+  int start = contacts.size();
+  for (int i = 0; i < b.worldVertices.size(); i++){
+    double distance = planeNormal.dot(b.worldVertices[i]) - planeOffset;
+    if (distance < 0){
+      BackendContact c;
+      c.body1 = body;
+      c.body2 = -1;
+      for (int k = 0; k < 3; k++){
+        c.pos[k] = b.worldVertices[i][k];
+        c.normal[k] = planeNormal[k];
+      }
+      c.depth = -distance;
+      contacts.push_back(c);
+    }
+  }
+  //keep the deepest ones if there are too many
+  if (contacts.size() - start > settings.maxContacts){
+    sort(contacts.begin()+start, contacts.end(), [](const BackendContact &x, const BackendContact &y){ return x.depth > y.depth; });
+    contacts.resize(start + settings.maxContacts);
+  }
+}
+
+
+/* projects a hull onto an axis */
+static void projectHull(const vector<Eigen::Vector3d> &vertices, const Eigen::Vector3d &axis, double &lo, double &hi){
+  lo = 1e300;
+  hi = -1e300;
+  for (int i = 0; i < vertices.size(); i++){
+    double p = axis.dot(vertices[i]);
+    lo = std::min(lo, p);
+    hi = std::max(hi, p);
+  }
+}
+
+
+/* true if point is inside the hull grown by margin */
+static bool insideHull(const ImpulseBody &body, const Eigen::Vector3d &point, double margin){
+  for (int f = 0; f < body.worldNormals.size(); f++){
+    if (body.worldNormals[f].dot(point) - body.worldOffsets[f] > margin) return false;
+  }
+  return true;
+}
+
+
+/* The face normal of either hull along which the two overlap the least is the contact normal (separating axis test
+   over face normals). Corners of each hull that are past the other hull along it and inside it are the contact points */
+void ImpulseBackend::collideBodies(int a, int b){
+  const ImpulseBody &bodyA = bodies[a];
+  const ImpulseBody &bodyB = bodies[b];
+  for (int k = 0; k < 3; k++){  //bounding boxes must overlap
+    if (bodyA.aabbMax[k] < bodyB.aabbMin[k] || bodyB.aabbMax[k] < bodyA.aabbMin[k]) return;
+  }
+
+  //find the axis of least overlap, oriented from B towards A
+  double best = 1e300;
+  Eigen::Vector3d normal;
+  for (int pass = 0; pass < 2; pass++){
+    const vector<Eigen::Vector3d> &normals = pass == 0 ? bodyA.worldNormals : bodyB.worldNormals;
+    for (int f = 0; f < normals.size(); f++){
+      double loA, hiA, loB, hiB;
+      projectHull(bodyA.worldVertices, normals[f], loA, hiA);
+      projectHull(bodyB.worldVertices, normals[f], loB, hiB);
+      double overlapUp = hiB - loA;     //A has to move along +normal by this much
+      double overlapDown = hiA - loB;   //or along -normal by this much
+      if (overlapUp < 0 || overlapDown < 0) return;  //separated
+      if (overlapUp < best){
+        best = overlapUp;
+        normal = normals[f];
+      }
+      if (overlapDown < best){
+        best = overlapDown;
+        normal = -normals[f];
+      }
+    }
+  }
+
+  double loA, hiA, loB, hiB;
+  projectHull(bodyA.worldVertices, normal, loA, hiA);
+  projectHull(bodyB.worldVertices, normal, loB, hiB);
+  double margin = best + 1e-4;   //corners lying on the other hull's edges still count
+  int start = contacts.size();
+  for (int pass = 0; pass < 2; pass++){
+    const ImpulseBody &inner = pass == 0 ? bodyA : bodyB;   //body whose corners are tested
+    const ImpulseBody &outer = pass == 0 ? bodyB : bodyA;   //body whose hull they may be inside
+    for (int i = 0; i < inner.worldVertices.size(); i++){
+      double p = normal.dot(inner.worldVertices[i]);
+      double depth = pass == 0 ? hiB - p : p - loA;
+      if (depth >= 0 && insideHull(outer, inner.worldVertices[i], margin)){
+        BackendContact c;
+        c.body1 = a;    //A is pushed out along the normal, B the other way
+        c.body2 = b;
+        for (int k = 0; k < 3; k++){
+          c.pos[k] = inner.worldVertices[i][k];
+          c.normal[k] = normal[k];
+        }
+        c.depth = std::min(depth, best);
+        contacts.push_back(c);
+      }
+    }
+  }
+  if (contacts.size() - start > settings.maxContacts){
+    sort(contacts.begin()+start, contacts.end(), [](const BackendContact &x, const BackendContact &y){ return x.depth > y.depth; });
+    contacts.resize(start + settings.maxContacts);
+  }
+}
+
+
+const vector<BackendContact>& ImpulseBackend::generateContacts(){
+  contacts.clear();
+  for (int i = 0; i < bodies.size(); i++){
+    updateWorldHull(bodies[i]);
+  }
+  for (int i = 0; i < bodies.size(); i++){
+    if (!bodies[i].enabled) continue;
+    collideGround(i);
+    for (int j = i+1; j < bodies.size(); j++){
+      if (bodies[j].enabled && bodies[j].group == bodies[i].group){
+        collideBodies(i, j);
+      }
+    }
+  }
+  return contacts;
+}
+
+
+/* true for bodies the solver may move: not the ground and not asleep */
+bool ImpulseBackend::moving(int body){
+  return body >= 0 && !bodies[body].asleep;
+}
+
+
+double ImpulseBackend::bodyInvMass(int body){
+  return moving(body) ? bodies[body].invMass : 0;
+}
+
+
+Eigen::Matrix3d ImpulseBackend::worldInvInertia(int body){
+  if (!moving(body)) return Eigen::Matrix3d::Zero();
+  const ImpulseBody &b = bodies[body];
+  return b.rotation * b.invInertia * b.rotation.transpose();
+}
+
+
+/* velocity of a point of a body, r is relative to its center of mass. The ground (-1) doesn't move */
+Eigen::Vector3d ImpulseBackend::velocityAt(int body, const Eigen::Vector3d &r){
+  if (!moving(body)) return Eigen::Vector3d::Zero();
+  return bodies[body].linearVel + bodies[body].angularVel.cross(r);
+}
+
+
+void ImpulseBackend::applyImpulse(int body, const Eigen::Vector3d &r, const Eigen::Vector3d &impulse){
+  if (!moving(body)) return;
+  ImpulseBody &b = bodies[body];
+  b.linearVel += b.invMass * impulse;
+  b.angularVel += worldInvInertia(body) * r.cross(impulse);
+}
+
+
+void ImpulseBackend::step(double timestep, int iterations){
+  //sleeping bodies touched by an awake one wake up
+  for (int c = 0; c < contacts.size(); c++){
+    int b1 = contacts[c].body1, b2 = contacts[c].body2;
+    if (b1 >= 0 && b2 >= 0 && bodies[b1].asleep != bodies[b2].asleep){
+      bodies[b1].asleep = bodies[b2].asleep = false;
+    }
+  }
+
+  //gravity
+  for (int i = 0; i < bodies.size(); i++){
+    if (bodies[i].invMass > 0 && bodies[i].enabled && !bodies[i].asleep){
+      bodies[i].linearVel += gravity * timestep;
+    }
+  }
+
+  //prepare the contacts: directions, effective masses and target velocities
+  solverContacts.resize(contacts.size());
+  for (int c = 0; c < contacts.size(); c++){
+    const BackendContact &in = contacts[c];
+    ImpulseContact &out = solverContacts[c];
+    Eigen::Vector3d pos(in.pos[0], in.pos[1], in.pos[2]);
+    out.normal = Eigen::Vector3d(in.normal[0], in.normal[1], in.normal[2]);
+    out.r1 = pos - bodies[in.body1].position;
+    out.r2 = in.body2 >= 0 ? Eigen::Vector3d(pos - bodies[in.body2].position) : Eigen::Vector3d::Zero();
+    out.tangent1 = out.normal.unitOrthogonal();
+    out.tangent2 = out.normal.cross(out.tangent1);
+
+    Eigen::Matrix3d inv1 = worldInvInertia(in.body1);
+    Eigen::Matrix3d inv2 = in.body2 >= 0 ? worldInvInertia(in.body2) : Eigen::Matrix3d(Eigen::Matrix3d::Zero());
+    double invMass = bodyInvMass(in.body1) + bodyInvMass(in.body2);
+    const Eigen::Vector3d *dirs[3] = {&out.normal, &out.tangent1, &out.tangent2};
+    double *masses[3] = {&out.normalMass, &out.tangentMass1, &out.tangentMass2};
+    for (int k = 0; k < 3; k++){
+      Eigen::Vector3d rn1 = out.r1.cross(*dirs[k]);
+      Eigen::Vector3d rn2 = out.r2.cross(*dirs[k]);
+      double k_eff = invMass + rn1.dot(inv1*rn1) + rn2.dot(inv2*rn2) + settings.softCFM;
+      *masses[k] = k_eff > 0 ? 1/k_eff : 0;
+    }
+
+    //push penetrating bodies apart a little each step, and bounce if approaching fast enough
+    out.bias = BAUMGARTE / timestep * std::max(in.depth - SLOP, 0.0);
+    if (settings.maxCorrectingVel > 0){
+      out.bias = std::min(out.bias, settings.maxCorrectingVel);
+    }
+    double approach = out.normal.dot(velocityAt(in.body1, out.r1) - velocityAt(in.body2, out.r2));
+    if (approach < -settings.bounceVel){
+      out.bias = std::max(out.bias, -settings.bounce * approach);
+    }
+    out.normalImpulse = out.tangentImpulse1 = out.tangentImpulse2 = 0;
+  }
+
+  //sequential impulses
+  for (int it = 0; it < iterations; it++){
+    for (int c = 0; c < contacts.size(); c++){
+      ImpulseContact &sc = solverContacts[c];
+      int b1 = contacts[c].body1;
+      int b2 = contacts[c].body2;
+
+      //normal: never pull, only push
+      Eigen::Vector3d dv = velocityAt(b1, sc.r1) - velocityAt(b2, sc.r2);
+      double lambda = sc.normalMass * (sc.bias - sc.normal.dot(dv));
+      double newImpulse = std::max(sc.normalImpulse + lambda, 0.0);
+      lambda = newImpulse - sc.normalImpulse;
+      sc.normalImpulse = newImpulse;
+      applyImpulse(b1, sc.r1, lambda * sc.normal);
+      applyImpulse(b2, sc.r2, -lambda * sc.normal);
+
+      //friction: stay inside the friction cone (a box with the friction pyramid's sides)
+      double maxFriction = settings.friction * sc.normalImpulse;
+      double *impulses[2] = {&sc.tangentImpulse1, &sc.tangentImpulse2};
+      const Eigen::Vector3d *tangents[2] = {&sc.tangent1, &sc.tangent2};
+      double masses[2] = {sc.tangentMass1, sc.tangentMass2};
+      for (int k = 0; k < 2; k++){
+        dv = velocityAt(b1, sc.r1) - velocityAt(b2, sc.r2);
+        lambda = -masses[k] * tangents[k]->dot(dv);
+        newImpulse = std::max(-maxFriction, std::min(*impulses[k] + lambda, maxFriction));
+        lambda = newImpulse - *impulses[k];
+        *impulses[k] = newImpulse;
+        applyImpulse(b1, sc.r1, lambda * *tangents[k]);
+        applyImpulse(b2, sc.r2, -lambda * *tangents[k]);
+      }
+    }
+  }
+
+  //move the bodies
+  double damping = 1 / (1 + DAMPING * timestep);
+  for (int i = 0; i < bodies.size(); i++){
+    ImpulseBody &b = bodies[i];
+    if (b.invMass <= 0 || !b.enabled || b.asleep) continue;
+    b.linearVel *= damping;
+    b.angularVel *= damping;
+    b.position += b.linearVel * timestep;
+    double angle = b.angularVel.norm() * timestep;
+    if (angle > 0){
+      b.rotation = Eigen::AngleAxisd(angle, b.angularVel.normalized()).toRotationMatrix() * b.rotation;
+    }
+  }
+}
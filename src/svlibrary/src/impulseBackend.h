@@ -0,0 +1,87 @@
+/****************************************************/
+//Description:  A small built in PhysicsBackend made for what SceneValidator usually sees: a few rigid objects,
+//              mostly at rest under gravity.  Every model is simplified to a convex hull of at most HULL_POINTS
+//              corners and the contacts are solved with sequential impulses (projected Gauss-Seidel with Baumgarte
+//              stabilization).  It doesn't need ODE at all, so it's also a reference for writing other backends.
+/****************************************************/
+
+#include "physicsBackend.h"
+#include "convexHull.h"
+#include <vector>
+#include <Eigen/Dense>
+#ifndef IMPULSEBACKEND_H
+#define IMPULSEBACKEND_H
+
+#define HULL_POINTS 64  // most corners a body's convex hull may have
+
+
+/* a rigid body of the impulse backend */
+struct ImpulseBody {
+    ConvexHull hull;                       //collision shape in the body's frame
+    double invMass;                        //1/mass
+    Eigen::Matrix3d invInertia;            //inverse inertia tensor in the body's frame
+    Eigen::Vector3d position;              //center of mass in the world
+    Eigen::Matrix3d rotation;              //body to world rotation
+    Eigen::Vector3d linearVel;
+    Eigen::Vector3d angularVel;
+    std::vector<Eigen::Vector3d> worldVertices;  //hull in world coordinates, updated by generateContacts()
+    std::vector<Eigen::Vector3d> worldNormals;
+    std::vector<double> worldOffsets;
+    Eigen::Vector3d aabbMin, aabbMax;            //world bounding box of the hull
+    int  group;                                  //collision group, see setCollisionGroup()
+    bool enabled;
+    bool asleep;                                 //doesn't move until an awake body touches it, see setAsleep()
+};
+
+
+/* a contact being solved, see step() */
+struct ImpulseContact {
+    Eigen::Vector3d r1, r2;                //contact point relative to each body's center of mass
+    Eigen::Vector3d normal, tangent1, tangent2;
+    double normalMass, tangentMass1, tangentMass2;  //1 / effective mass along each direction
+    double bias;                           //target separating velocity (penetration correction and bounce)
+    double normalImpulse, tangentImpulse1, tangentImpulse2;  //accumulated impulses
+};
+
+
+class ImpulseBackend : public PhysicsBackend{
+    public:
+        ImpulseBackend();
+
+        PhysicsBackend* emptyCopy() const;
+        int  createBody(const float *vertices, int vertCount, const int *indices, int triCount, double density);
+        void destroyBody(int body);
+        void setPose(int body, const double position[3], const double R[12]);
+        void getPose(int body, double position[3], double R[12]);
+        double getMass(int body);
+        void getVelocity(int body, double linear[3], double angular[3]);
+        const std::vector<BackendContact>& generateContacts();
+        void step(double timestep, int iterations);
+        void setGravity(double x, double y, double z);
+        void setGroundPlane(double a, double b, double c, double d);
+        void setCollisionGroup(int body, int group);
+        void setEnabled(int body, bool enabled);
+        void setAsleep(int body);
+        void configure(const BackendSettings &settings);
+
+    private:
+        void updateWorldHull(ImpulseBody &body);
+        void collideGround(int body);
+        void collideBodies(int a, int b);
+        void applyImpulse(int body, const Eigen::Vector3d &r, const Eigen::Vector3d &impulse);
+        Eigen::Vector3d velocityAt(int body, const Eigen::Vector3d &r);
+        Eigen::Matrix3d worldInvInertia(int body);
+        double bodyInvMass(int body);
+        bool moving(int body);
+
+        std::vector<ImpulseBody> bodies;
+        std::vector<int> freeBodies;                  //handles of destroyed bodies, reused by createBody()
+        std::vector<BackendContact> contacts;         //contacts found by the last generateContacts()
+        std::vector<ImpulseContact> solverContacts;   //the same contacts prepared for the solver
+        Eigen::Vector3d gravity;
+        Eigen::Vector3d planeNormal;
+        double planeOffset;
+        BackendSettings settings;
+};
+
+#endif
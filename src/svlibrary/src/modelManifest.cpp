@@ -0,0 +1,62 @@
+/****************************************************/
+//Description:  Reads model manifests, see modelManifest.h
+/****************************************************/
+
+#include "modelManifest.h"
+#include <fstream>                //used to read the manifest
+#include <sstream>                //used to split its lines
+#include <iostream>               //used for printing errors
+
+using namespace std;
+
+
+bool ModelManifest::read(string filename){
+  ifstream in(filename.c_str());
+  if (!in){
+    cout<<"***ERROR*** in ModelManifest::read(). Couldn't open "<<filename<<endl;
+    return false;
+  }
+  string directory;
+  size_t slash = filename.find_last_of('/');
+  if (slash != string::npos){
+    directory = filename.substr(0, slash + 1);
+  }
+
+  string line;
+  int number = 0;
+  while (getline(in, line)){
+    number++;
+    istringstream words(line);
+    string kind;
+    if (!(words >> kind) || kind[0] == '#'){
+      continue;
+    }
+    if (kind == "model"){
+      string name, file;
+      double scale = 0;
+      if (!(words >> name >> file)){
+        cout<<"***ERROR*** in ModelManifest::read(). Line "<<number<<" of "<<filename<<" should be: model <name> <file.obj> [scale]"<<endl;
+        return false;
+      }
+      words >> scale;
+      if (file[0] != '/'){
+        file = directory + file;
+      }
+      names.push_back(name);
+      files.push_back(file);
+      scales.push_back(scale);
+    } else if (kind == "param"){
+      string name;
+      double value;
+      if (!(words >> name >> value)){
+        cout<<"***ERROR*** in ModelManifest::read(). Line "<<number<<" of "<<filename<<" should be: param <NAME> <value>"<<endl;
+        return false;
+      }
+      params.push_back(make_pair(name, value));
+    } else {
+      cout<<"***ERROR*** in ModelManifest::read(). Line "<<number<<" of "<<filename<<" starts with "<<kind<<", not model or param"<<endl;
+      return false;
+    }
+  }
+  return true;
+}
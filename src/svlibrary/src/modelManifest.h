@@ -0,0 +1,26 @@
+/****************************************************/
+//Description:  A text file listing the models a program should load and the parameters it should use, so programs
+//              which aren't compiled against a scene (the validation daemon) can be told what to load.  One entry per line:
+//                  model <name> <file.obj> [scale]
+//                  param <NAME> <value>
+//              Blank lines and lines starting with # are skipped.  Relative .obj paths are relative to the manifest.
+/****************************************************/
+
+#include <string>
+#include <vector>
+#include <utility>
+#ifndef MODELMANIFEST_H
+#define MODELMANIFEST_H
+
+
+struct ModelManifest {
+    std::vector<std::string> names;                          //model names, in the order of the file
+    std::vector<std::string> files;                          //their .obj files
+    std::vector<double> scales;                              //their scales, 0 where none was given
+    std::vector< std::pair<std::string,double> > params;     //setParams() calls, in the order of the file
+
+    /* Reads a manifest. Returns false (and prints the line) if it can't be read or a line doesn't make sense */
+    bool read(std::string filename);
+};
+
+#endif
@@ -0,0 +1,180 @@
+/****************************************************/
+//Description:  Writes and maps model stores, see modelStore.h.  The file is the magic, the number of models, their
+//              StoredModel directory and then the arrays, each padded to 8 bytes.
+/****************************************************/
+
+#include "modelStore.h"
+#include <map>                    //used for the stores shared by the process
+#include <mutex>                  //used to guard them
+#include <fstream>                //used to write a store
+#include <stdio.h>                //used for rename
+#include <iostream>               //used for printing errors
+#include <string.h>               //used for memcmp and strncpy
+#include <fcntl.h>                //used to open the file
+#include <unistd.h>               //used for close
+#include <sys/mman.h>             //used to map the file
+#include <sys/stat.h>             //used to get the file's size
+
+using namespace std;
+
+#define HEADER_BYTES 16           // the magic and the number of models (with padding)
+
+
+ModelStore::ModelStore() : mapping(0), size(0), count(0), directory(0){
+}
+
+
+ModelStore::~ModelStore(){
+  if (mapping){
+    munmap((void*)mapping, size);
+  }
+}
+
+
+/* true if an array of bytes at offset lies inside the file */
+static bool inside(uint64_t offset, uint64_t bytes, size_t size){
+  return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+}
+
+
+bool ModelStore::open(string filename){
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) < 0){
+    cout<<"***ERROR*** in ModelStore::open(). Couldn't open "<<filename<<endl;
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  size = info.st_size;
+  void *memory = size >= HEADER_BYTES ? mmap(0, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);  //the mapping stays
+  if (memory == MAP_FAILED){
+    cout<<"***ERROR*** in ModelStore::open(). Couldn't map "<<filename<<endl;
+    return false;
+  }
+  mapping = (const char*)memory;
+
+  //check everything once, so nothing has to be checked later
+  memcpy(&count, mapping + 8, 4);
+  directory = (const StoredModel*)(mapping + HEADER_BYTES);
+  bool good = memcmp(mapping, MODELSTORE_MAGIC, 8) == 0 && inside(HEADER_BYTES, (uint64_t)count * sizeof(StoredModel), size);
+  for (int i = 0; good && i < count; i++){
+    const StoredModel &m = directory[i];
+    good = memchr(m.name, 0, MODELSTORE_NAME) != 0
+        && inside(m.vertexOffset, (uint64_t)m.vertCount * 12, size)
+        && inside(m.indexOffset, (uint64_t)m.triCount * 12, size)
+        && inside(m.hullOffset, (uint64_t)m.hullCount * 24, size)
+        && inside(m.hullIndexOffset, (uint64_t)m.hullTriCount * 12, size)
+        && inside(m.boxOffset, 24 * 4, size);
+    const int32_t *indices = (const int32_t*)(mapping + m.indexOffset);
+    for (uint64_t k = 0; good && k < 3 * (uint64_t)m.triCount; k++){
+      good = indices[k] >= 0 && indices[k] < m.vertCount;
+    }
+    const int32_t *hullIndices = (const int32_t*)(mapping + m.hullIndexOffset);
+    for (uint64_t k = 0; good && k < 3 * (uint64_t)m.hullTriCount; k++){
+      good = hullIndices[k] >= 0 && hullIndices[k] < m.hullCount;
+    }
+  }
+  if (!good){
+    cout<<"***ERROR*** in ModelStore::open(). "<<filename<<" isn't a model store or is damaged"<<endl;
+    munmap(memory, size);
+    mapping = 0;
+    directory = 0;
+    count = 0;
+    return false;
+  }
+  return true;
+}
+
+
+const StoredModel* ModelStore::find(string name){
+  for (int i = 0; i < count; i++){
+    if (name == directory[i].name){
+      return &directory[i];
+    }
+  }
+  return 0;
+}
+
+
+const char* ModelStore::data(){
+  return mapping;
+}
+
+
+vector<string> ModelStore::getModelNames(){
+  vector<string> names;
+  for (int i = 0; i < count; i++){
+    names.push_back(directory[i].name);
+  }
+  return names;
+}
+
+
+/* appends bytes to the file image and pads it to 8 bytes, returns where they start */
+static uint64_t append(string &image, const void *bytes, size_t length){
+  uint64_t offset = image.size();
+  image.append((const char*)bytes, length);
+  image.append((8 - image.size() % 8) % 8, '\0');
+  return offset;
+}
+
+
+bool ModelStore::write(string filename, const vector<ModelArrays> &models){
+  string image(HEADER_BYTES + models.size() * sizeof(StoredModel), '\0');
+  memcpy(&image[0], MODELSTORE_MAGIC, 8);
+  uint32_t modelCount = models.size();
+  memcpy(&image[8], &modelCount, 4);
+
+  for (int i = 0; i < models.size(); i++){
+    const ModelArrays &a = models[i];
+    if (a.name.size() >= MODELSTORE_NAME){
+      cout<<"***ERROR*** in ModelStore::write(). The name "<<a.name<<" is longer than "<<MODELSTORE_NAME-1<<" characters"<<endl;
+      return false;
+    }
+    StoredModel m;
+    memset(&m, 0, sizeof(m));
+    strncpy(m.name, a.name.c_str(), MODELSTORE_NAME - 1);
+    m.scale = a.scale;
+    for (int k = 0; k < 3; k++) m.centerOfMass[k] = a.centerOfMass[k];
+    m.radius = a.radius;
+    m.vertCount = a.vertCount;
+    m.triCount = a.triCount;
+    m.hullCount = a.hull.size() / 3;
+    m.hullTriCount = a.hullIndices.size() / 3;
+    m.vertexOffset = append(image, a.vertices, a.vertCount * 12);
+    m.indexOffset = append(image, a.indices, a.triCount * 12);
+    m.hullOffset = append(image, a.hull.data(), a.hull.size() * 8);
+    m.hullIndexOffset = append(image, a.hullIndices.data(), a.hullIndices.size() * 4);
+    m.boxOffset = append(image, a.box, 24 * 4);
+    memcpy(&image[HEADER_BYTES + i * sizeof(StoredModel)], &m, sizeof(m));
+  }
+
+  //written next to the old store and renamed, processes which have the old one mapped keep it
+  string temporary = filename + ".tmp";
+  ofstream out(temporary.c_str(), ios::binary);
+  out.write(image.data(), image.size());
+  out.close();
+  if (!out || rename(temporary.c_str(), filename.c_str()) != 0){
+    cout<<"***ERROR*** in ModelStore::write(). Couldn't write "<<filename<<endl;
+    return false;
+  }
+  return true;
+}
+
+
+shared_ptr<ModelStore> ModelStore::shared(string filename){
+  static std::mutex mutex;
+  static map<string, shared_ptr<ModelStore> > stores;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = stores.find(filename);
+  if (found != stores.end()){
+    return found->second;
+  }
+  shared_ptr<ModelStore> store(new ModelStore());
+  if (!store->open(filename)){
+    return shared_ptr<ModelStore>();
+  }
+  stores[filename] = store;
+  return store;
+}
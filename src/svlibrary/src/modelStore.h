@@ -0,0 +1,80 @@
+/****************************************************/
+//Description:  A model store is a file of models already prepared for simulation: each model's trimesh (scaled and
+//              shifted so the center of mass is at 0,0,0), its center of mass in the .obj's frame, its radius, convex
+//              hull and bounding box.  SceneValidator::setModels() maps a store read-only instead of parsing .obj files
+//              when it's given one (a file ending in .svstore), and the trimeshes point straight into the mapping, so the
+//              geometry is in memory once however many validators and processes use it.  The file is written in the
+//              machine's own byte order and every array starts on an 8 byte boundary.
+/****************************************************/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+#ifndef MODELSTORE_H
+#define MODELSTORE_H
+
+#define MODELSTORE_MAGIC "SVSTORE1"  // first 8 bytes of a store
+#define MODELSTORE_NAME 64           // longest model name, with its terminating 0
+
+
+/* one model's entry in the store's directory, offsets are from the start of the file */
+struct StoredModel {
+    char     name[MODELSTORE_NAME];
+    double   scale;                   //the model was divided by this
+    double   centerOfMass[3];         //in the .obj's frame, after scaling
+    double   radius;                  //distance from the center of mass to the furthest vertex
+    uint32_t vertCount;               //3 floats each at vertexOffset
+    uint32_t triCount;                //3 int32 each at indexOffset
+    uint32_t hullCount;               //convex hull corners, 3 doubles each at hullOffset
+    uint32_t hullTriCount;            //hull triangles, 3 int32 each at hullIndexOffset
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t hullOffset;
+    uint64_t hullIndexOffset;
+    uint64_t boxOffset;               //8 corners of the oriented bounding box, 3 floats each
+};
+
+
+/* the arrays of one model, for writing a store */
+struct ModelArrays {
+    std::string name;
+    double scale;
+    double centerOfMass[3];
+    double radius;
+    const float *vertices;  int vertCount;
+    const int *indices;     int triCount;
+    std::vector<double> hull;         //3 per corner
+    std::vector<int> hullIndices;     //3 per triangle
+    const float *box;                 //24 floats
+};
+
+
+class ModelStore{
+    public:
+        ModelStore();
+        ~ModelStore();  //unmaps the file
+
+        /* Maps a store read-only. Returns false (and prints why) if it isn't a valid store */
+        bool open(std::string filename);
+
+        /* Returns the entry of a model, 0 if the store doesn't have it. The arrays are at data() + its offsets */
+        const StoredModel* find(std::string name);
+        const char* data();
+        std::vector<std::string> getModelNames();
+
+        /* Writes models to a store */
+        static bool write(std::string filename, const std::vector<ModelArrays> &models);
+
+        /* The store mapped from filename, mapped the first time it's asked for and kept for the rest of the process so
+           every validator in the process shares one mapping. 0 if it can't be opened */
+        static std::shared_ptr<ModelStore> shared(std::string filename);
+
+    private:
+        const char *mapping;
+        size_t size;
+        uint32_t count;                   //models in the directory
+        const StoredModel *directory;
+};
+
+#endif
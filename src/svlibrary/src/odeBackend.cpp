@@ -0,0 +1,507 @@
+/****************************************************/
+//Description:  PhysicsBackend using Open Dynamics Engine.  This is the ODE code that used to live in sceneValidator.cpp,
+//              most of it is from the ODE trimesh demo (demo_moving_trimesh.cpp).
+/****************************************************/
+
+#include "odeBackend.h"
+#include <algorithm>              //used for std::max
+#include <iostream>               //used for printing
+
+using namespace std;
+
+
+/* the body handle stored in an ODE body, -1 for the ground (no body) */
+static int bodyHandle(dBodyID b){
+  return b ? (int)(size_t)dBodyGetData(b) : -1;
+}
+
+
+/* Handles objects' collisions (makes a termporary joint)
+   This is called by dSpaceCollide when two objects in space are potentially colliding.
+   I did not alter this function from ODE trimesh demo except for the parameter values. */
+static void nearCallback (void *data, dGeomID o1, dGeomID o2)
+{
+  OdeBackend *backend = (OdeBackend*)data;
+  // exit without doing anything if the two bodies are connected by a joint
+  dBodyID b1 = dGeomGetBody(o1);
+  dBodyID b2 = dGeomGetBody(o2);
+  if (b1 && b2 && dAreConnectedExcluding (b1,b2,dJointTypeContact)) return;
+
+  //execute collision force (temporary joint)
+  backend->collide(o1, o2);
+}
+
+
+/* runs dCollide on one pair and keeps its contacts */
+void OdeBackend::collide(dGeomID o1, dGeomID o2){
+  if (int numc = dCollide (o1,o2,settings.maxContacts,contactBuffer.data(),sizeof(dContactGeom))) {
+    addContacts(o1, o2, contactBuffer.data(), numc);
+  }
+}
+
+
+/* turns the contacts of one pair into joints and remembers them */
+void OdeBackend::addContacts(dGeomID o1, dGeomID o2, dContactGeom *geoms, int numc){
+  dBodyID b1 = dGeomGetBody(o1);
+  dBodyID b2 = dGeomGetBody(o2);
+  dContact contact;
+  contact.surface.mode = dContactBounce | dContactSoftCFM;
+  contact.surface.mu = settings.friction;
+  contact.surface.mu2 = settings.friction2;
+  contact.surface.bounce = settings.bounce;
+  contact.surface.bounce_vel = settings.bounceVel;
+  contact.surface.soft_cfm = settings.softCFM;
+  for (int i=0; i<numc; i++) {
+    contact.geom = geoms[i];
+    dJointID c = dJointCreateContact (world,contactgroup,&contact);
+    dJointAttach (c,b1,b2);
+
+    BackendContact found;
+    found.body1 = bodyHandle(b1);
+    found.body2 = bodyHandle(b2);
+    for (int k = 0; k < 3; k++){
+      found.pos[k] = geoms[i].pos[k];
+      found.normal[k] = geoms[i].normal[k];
+    }
+    found.depth = geoms[i].depth;
+    contacts.push_back(found);
+  }
+}
+
+
+/* Parallel narrowphase. Instead of making joints straight from nearCallback, the broadphase (dSpaceCollide) only collects
+   candidate pairs. The pairs are then handed out to collideThreads threads which run dCollide, each pair writing its contacts
+   into its own slot of the contact buffer. Finally the slots are turned into contact joints in pair order, so the joints
+   (and therefore the simulation) are the same no matter how many threads were used or which thread handled which pair.
+   NOTE: this needs an ODE build whose trimesh collider keeps its caches per thread (the default TLS build). */
+
+/* called by dSpaceCollide, only remembers the pair */
+static void collectPairCallback (void *data, dGeomID o1, dGeomID o2)
+{
+  ((OdeBackend*)data)->collectPair(o1, o2);
+}
+
+void OdeBackend::collectPair(dGeomID o1, dGeomID o2){
+  dBodyID b1 = dGeomGetBody(o1);
+  dBodyID b2 = dGeomGetBody(o2);
+  if (b1 && b2 && dAreConnectedExcluding (b1,b2,dJointTypeContact)) return;
+  candidatePairs.push_back(make_pair(o1,o2));
+}
+
+/* keep taking pairs until all are done */
+void OdeBackend::collidePairs(){
+  int i;
+  while ((i = nextPair++) < (int)candidatePairs.size()){
+    pairContactCount[i] = dCollide(candidatePairs[i].first, candidatePairs[i].second, settings.maxContacts,
+                                   &pairContacts[i*settings.maxContacts], sizeof(dContactGeom));
+  }
+}
+
+/* helper thread, sleeps until a new round of pairs is ready */
+void OdeBackend::collideWorker(){
+  dAllocateODEDataForThread(dAllocateMaskAll);  //ODE needs its collision data allocated in every thread that calls dCollide
+  int seenRound = 0;
+  while (true){
+    {
+      unique_lock<mutex> lock(collideMutex);
+      collideWake.wait(lock, [&]{ return collideQuit || collideRound != seenRound; });
+      if (collideQuit) break;
+      seenRound = collideRound;
+    }
+    collidePairs();
+    {
+      lock_guard<mutex> lock(collideMutex);
+      collideBusy--;
+    }
+    collideDone.notify_one();
+  }
+  dCleanupODEAllDataForThread();
+}
+
+/* stops and joins the helper threads */
+void OdeBackend::stopCollideWorkers(){
+  {
+    lock_guard<mutex> lock(collideMutex);
+    collideQuit = true;
+  }
+  collideWake.notify_all();
+  for (int i = 0; i < collideWorkers.size(); i++){
+    collideWorkers[i].join();
+  }
+  collideWorkers.clear();
+  collideQuit = false;
+}
+
+/* collision detection for one step using collideThreads threads */
+void OdeBackend::parallelCollide(){
+  //(re)start the helpers if collideThreads changed
+  if (collideWorkers.size() != settings.collideThreads-1){
+    stopCollideWorkers();
+    for (int i = 0; i < settings.collideThreads-1; i++){
+      collideWorkers.push_back(thread(&OdeBackend::collideWorker, this));
+    }
+  }
+
+  //broadphase
+  candidatePairs.clear();
+  dSpaceCollide (space,this,&collectPairCallback);
+  int numPairs = candidatePairs.size();
+  if (pairContacts.size() < numPairs*settings.maxContacts){
+    pairContacts.resize(numPairs*settings.maxContacts);
+  }
+  pairContactCount.assign(numPairs, 0);
+
+  //narrowphase, spread over the helpers and this thread
+  nextPair = 0;
+  {
+    lock_guard<mutex> lock(collideMutex);
+    collideBusy = collideWorkers.size();
+    collideRound++;
+  }
+  collideWake.notify_all();
+  collidePairs();
+  {
+    unique_lock<mutex> lock(collideMutex);
+    collideDone.wait(lock, [this]{ return collideBusy == 0; });
+  }
+
+  //merge the contacts into joints, always in pair order
+  for (int i = 0; i < numPairs; i++){
+    if (pairContactCount[i]){
+      addContacts(candidatePairs[i].first, candidatePairs[i].second, &pairContacts[i*settings.maxContacts], pairContactCount[i]);
+    }
+  }
+}
+
+
+/* runs collision detection and makes this step's contact joints */
+const vector<BackendContact>& OdeBackend::generateContacts(){
+  contacts.clear();
+  dJointGroupEmpty (contactgroup);  //joints of an earlier call that wasn't followed by step()
+  if (settings.collideThreads > 1){
+    parallelCollide();
+  } else {
+    dSpaceCollide (space,this,&nearCallback);
+  }
+  return contacts;
+}
+
+
+/* set previous transformation matrix for trimesh
+   not entirely sure what this function's purpose is as it was directly from ODE trimesh demo */
+static void setCurrentTransform(dGeomID geom){
+   const dReal* Pos = dGeomGetPosition(geom);  //get the object's current position
+   const dReal* Rot = dGeomGetRotation(geom);  //get the object's current rotation
+   const dReal Transform[16] =
+   {
+     Rot[0], Rot[4], Rot[8],  0,
+     Rot[1], Rot[5], Rot[9],  0,
+     Rot[2], Rot[6], Rot[10], 0,
+     Pos[0], Pos[1], Pos[2],  1
+   };
+   dGeomTriMeshSetLastTransform( geom, *(dMatrix4*)(&Transform) );
+}
+
+
+/* one simulation step */
+void OdeBackend::step(double timestep, int iterations){
+//not quite sure what this code block or what setCurrentTransform() does, but it was from ODE trimesh demo
+#if 1
+  for (int i=0; i<bodies.size(); i++)
+    for (int j=0; j < GPB; j++)
+      if (bodies[i].geom[j])
+        if (dGeomGetClass(bodies[i].geom[j]) == dTriMeshClass)
+          setCurrentTransform(bodies[i].geom[j]);
+#endif
+
+  dWorldSetQuickStepNumIterations (world,iterations);
+  dWorldQuickStep (world,timestep); //<- this is a big factor in accuracy and how long simulation takes
+
+  // remove all contact joints
+  dJointGroupEmpty (contactgroup);
+
+  //not quite sure what the following code from here until the end of this function does but it was from ODE's trimesh demos
+  //the following comments are from the demo as well
+  for (int i=0; i<bodies.size(); i++) {
+    for (int j=0; j < GPB; j++) {
+      if (bodies[i].geom[j] && dGeomGetClass(bodies[i].geom[j]) == dTriMeshClass) {
+        const dReal* Pos = dGeomGetPosition(bodies[i].geom[j]);
+        const dReal* Rot = dGeomGetRotation(bodies[i].geom[j]);
+
+        // tell the tri-tri collider the current transform of the trimesh --
+        // this is fairly important for good results.
+        // Fill in the (4x4) matrix.
+        dReal* p_matrix = bodies[i].matrix_dblbuff + ( bodies[i].last_matrix_index * 16 );
+
+        p_matrix[ 0 ] = Rot[ 0 ];	p_matrix[ 1 ] = Rot[ 1 ];	p_matrix[ 2 ] = Rot[ 2 ];	p_matrix[ 3 ] = 0;
+        p_matrix[ 4 ] = Rot[ 4 ];	p_matrix[ 5 ] = Rot[ 5 ];	p_matrix[ 6 ] = Rot[ 6 ];	p_matrix[ 7 ] = 0;
+        p_matrix[ 8 ] = Rot[ 8 ];	p_matrix[ 9 ] = Rot[ 9 ];	p_matrix[10 ] = Rot[10 ];	p_matrix[11 ] = 0;
+        p_matrix[12 ] = Pos[ 0 ];	p_matrix[13 ] = Pos[ 1 ];	p_matrix[14 ] = Pos[ 2 ];	p_matrix[15 ] = 1;
+
+        // Flip to other matrix.
+        bodies[i].last_matrix_index = !bodies[i].last_matrix_index;
+
+        dGeomTriMeshSetLastTransform( bodies[i].geom[j],
+          *(dMatrix4*)( bodies[i].matrix_dblbuff + bodies[i].last_matrix_index * 16 ) );
+      }
+    }
+  }
+}
+
+
+/* construct the object and put it into the world */
+int OdeBackend::createBody(const float *vertices, int vertCount, const int *indices, int triCount, double density){
+  OdeBody object = OdeBody();
+  dMass m;  //this is ODE's special "mass" object. It contains inertia info, actual weight and center of mass. Look at mass.h and mass.cpp for more info in ODE library
+  int handle = bodies.size();
+  if (!freeBodies.empty()){  //reuse a destroyed body's slot
+    handle = freeBodies.back();
+    freeBodies.pop_back();
+  }
+
+  object.body = dBodyCreate (world);  //you must create a "body" AND a "geom" (geometry) to represent an model in ODE
+  dBodySetData (object.body,(void*)(size_t)handle);
+
+  //build Trimesh geom
+  dTriMeshDataID new_tmdata = dGeomTriMeshDataCreate();  //set a trimesh ODE data type
+  dGeomTriMeshDataBuildSingle(new_tmdata, vertices, 3 * sizeof(float),    //build the geometry of the trimesh
+	     vertCount, indices, triCount*3, 3 * sizeof(int));
+  object.geom[0] = dCreateTriMesh(space, new_tmdata, 0, 0, 0);  //create the trimesh using the ODE trimesh data that was just defined
+  dGeomSetData(object.geom[0], new_tmdata);  //officially set the data into the object's geom (geometry)
+  dMassSetTrimesh( &m, density, object.geom[0] );  //set the trimesh's mass
+
+  dGeomSetPosition(object.geom[0], m.c[0], m.c[1], m.c[2]);  //this is required because ODE's mass has to be at (0,0,0)
+  dMassTranslate(&m, -m.c[0], -m.c[1], -m.c[2]);  //object's center of mass must be at 0,0,0 relative to the rest of the object
+
+  //build Trimesh body and unite geom with body
+  for (int k=0; k < GPB; k++){  //set body loop
+      if (object.geom[k]){
+          dGeomSetBody(object.geom[k],object.body); //unite body and geometry
+      }
+  }
+  dBodySetMass(object.body,&m);  //set the body's mass
+
+  if (handle == bodies.size()){
+    bodies.push_back(object);
+  } else {
+    bodies[handle] = object;
+  }
+  return handle;
+}
+
+
+/* destroys a body, its geoms and their trimesh data */
+void OdeBackend::destroyBody(int body){
+  OdeBody &object = bodies[body];
+  if (!object.body){  //already destroyed
+    return;
+  }
+  for (int k = 0; k < GPB; k++){
+    if (object.geom[k]){
+      dTriMeshDataID data = dGeomGetClass(object.geom[k]) == dTriMeshClass ? (dTriMeshDataID)dGeomGetData(object.geom[k]) : 0;
+      dGeomDestroy(object.geom[k]);
+      if (data){
+        dGeomTriMeshDataDestroy(data);
+      }
+    }
+  }
+  dBodyDestroy(object.body);
+  object = OdeBody();
+  freeBodies.push_back(body);
+}
+
+
+/* set a body's 6DoF pose */
+void OdeBackend::setPose(int body, const double position[3], const double R[12]){
+  dBodySetPosition (bodies[body].body, position[0], position[1], position[2]);  //now we ACTUALLY set it's position in the simulation
+  dBodySetRotation (bodies[body].body, R);        //set it's rotation
+  dBodySetLinearVel(bodies[body].body, 0, 0, 0);  //set linear velocity to 0, else it would keep old lin. & ang. vel. from before we translated it
+  dBodySetAngularVel(bodies[body].body, 0, 0, 0); //set angular velocity to 0
+}
+
+
+void OdeBackend::getPose(int body, double position[3], double R[12]){
+  const dReal* pos = dBodyGetPosition(bodies[body].body);
+  const dReal* rot = dBodyGetRotation(bodies[body].body);
+  std::copy(pos, pos+3, position);
+  std::copy(rot, rot+12, R);
+}
+
+
+double OdeBackend::getMass(int body){
+  dMass m;
+  dBodyGetMass(bodies[body].body, &m);
+  return m.mass;
+}
+
+
+void OdeBackend::getVelocity(int body, double linear[3], double angular[3]){
+  const dReal* v = dBodyGetLinearVel(bodies[body].body);
+  const dReal* w = dBodyGetAngularVel(bodies[body].body);
+  std::copy(v, v+3, linear);
+  std::copy(w, w+3, angular);
+}
+
+
+/* uses ODE's category and collide bits. The ground keeps all its bits set so it still collides with every group */
+void OdeBackend::setCollisionGroup(int body, int group){
+  unsigned long bits = 1UL << group;
+  for (int k = 0; k < GPB; k++){
+    if (bodies[body].geom[k]){
+      dGeomSetCategoryBits(bodies[body].geom[k], bits);
+      dGeomSetCollideBits(bodies[body].geom[k], bits);
+    }
+  }
+}
+
+
+void OdeBackend::setEnabled(int body, bool enabled){
+  if (enabled){
+    dBodyEnable(bodies[body].body);
+  } else {
+    dBodyDisable(bodies[body].body);
+  }
+  for (int k = 0; k < GPB; k++){
+    if (bodies[body].geom[k]){
+      if (enabled){
+        dGeomEnable(bodies[body].geom[k]);
+      } else {
+        dGeomDisable(bodies[body].geom[k]);
+      }
+    }
+  }
+}
+
+
+/* a disabled ODE body whose geoms are still enabled. ODE enables it again as soon as a contact joint connects it to an enabled body */
+void OdeBackend::setAsleep(int body){
+  setEnabled(body, true);
+  dBodyDisable(bodies[body].body);
+}
+
+
+void OdeBackend::setGravity(double x, double y, double z){
+  dWorldSetGravity (world,x,y,z);
+}
+
+
+void OdeBackend::setGroundPlane(double a, double b, double c, double d){
+  if (ground){
+    dGeomDestroy(ground);
+  }
+  ground = dCreatePlane (space,a,b,c,d);
+  if (heightfield){
+    dGeomDisable(ground);
+  }
+}
+
+
+void OdeBackend::configure(const BackendSettings &newSettings){
+  settings = newSettings;
+  settings.collideThreads = std::max(1, settings.collideThreads);
+  contactBuffer.resize(settings.maxContacts);
+  dWorldSetContactMaxCorrectingVel (world, settings.maxCorrectingVel > 0 ? settings.maxCorrectingVel : dInfinity);
+}
+
+
+/* tells ODE the lowest and highest heights in the grid so the heightfield's bounding box fits the data */
+void OdeBackend::setHeightfieldBounds(){
+  double minHeight = heightfieldHeights[0];
+  double maxHeight = heightfieldHeights[0];
+  for (int i = 1; i < heightfieldSamples; i++){
+    minHeight = std::min(minHeight, heightfieldHeights[i]);
+    maxHeight = std::max(maxHeight, heightfieldHeights[i]);
+  }
+  dGeomHeightfieldDataSetBounds(heightfieldData, minHeight, maxHeight);
+}
+
+
+/* replaces the ground plane with a heightfield made from a grid of heights */
+bool OdeBackend::setSupportSurface(const double *heights, int widthSamples, int depthSamples, double width, double depth,
+                                   double thickness, const double position[3], const double R[12]){
+  clearSupportSurface();
+
+  //ODE keeps a pointer to heights instead of copying them (bCopyHeightData = 0)
+  heightfieldHeights = heights;
+  heightfieldSamples = widthSamples*depthSamples;
+  heightfieldData = dGeomHeightfieldDataCreate();
+  dGeomHeightfieldDataBuildDouble(heightfieldData, heightfieldHeights, 0, width, depth,
+       widthSamples, depthSamples, 1.0, 0.0, thickness, 0);
+  setHeightfieldBounds();
+  heightfield = dCreateHeightfield(space, heightfieldData, 1);
+  dGeomSetRotation(heightfield, R);
+  dGeomSetPosition(heightfield, position[0], position[1], position[2]);
+
+  dGeomDisable(ground);  //the heightfield is now the only support surface
+  return true;
+}
+
+
+/* the heights were rewritten in place, refresh the bounds */
+bool OdeBackend::updateSupportSurface(){
+  if (!heightfield){
+    return false;
+  }
+  setHeightfieldBounds();
+  //setting the position again marks the geom as moved so ODE recomputes its bounding box with the new bounds
+  const dReal* pos = dGeomGetPosition(heightfield);
+  dGeomSetPosition(heightfield, pos[0], pos[1], pos[2]);
+  return true;
+}
+
+
+/* removes the heightfield and goes back to using the ground plane */
+void OdeBackend::clearSupportSurface(){
+  if (heightfield){
+    dGeomDestroy(heightfield);
+    dGeomHeightfieldDataDestroy(heightfieldData);
+    heightfield = 0;
+    heightfieldData = 0;
+  }
+  if (ground){
+    dGeomEnable(ground);
+  }
+}
+
+
+OdeBackend::OdeBackend() : nextPair(0), collideRound(0), collideBusy(0), collideQuit(false){
+  contactBuffer.resize(settings.maxContacts);
+  //initialize the simulation enviornment
+  world = dWorldCreate();
+  space = dSimpleSpaceCreate(0);
+  contactgroup = dJointGroupCreate (0);
+  dWorldSetCFM (world,1e-5);
+  ground = 0;
+  heightfield = 0;
+  heightfieldData = 0;
+  heightfieldHeights = 0;
+  heightfieldSamples = 0;
+  //initialize ODE's threading functions
+  threading = dThreadingAllocateMultiThreadedImplementation();
+  pool = dThreadingAllocateThreadPool(4, 0, dAllocateFlagBasicData, NULL);
+  dThreadingThreadPoolServeMultiThreadedImplementation(pool, threading);
+  dWorldSetStepThreadingImplementation(world, dThreadingImplementationGetFunctions(threading), threading);
+}
+
+
+PhysicsBackend* OdeBackend::emptyCopy() const{
+  return new OdeBackend();
+}
+
+
+OdeBackend::~OdeBackend(){
+  //shut down threading
+  stopCollideWorkers();
+  dThreadingImplementationShutdownProcessing(threading);
+  dThreadingFreeThreadPool(pool);
+  dWorldSetStepThreadingImplementation(world, NULL, NULL);
+  dThreadingFreeImplementation(threading);
+  //shut down simulation enviornment
+  clearSupportSurface();
+  for (int i = 0; i < bodies.size(); i++){  //the trimesh data isn't freed with the space
+    destroyBody(i);
+  }
+  dJointGroupDestroy (contactgroup);
+  dSpaceDestroy (space);
+  dWorldDestroy (world);
+}
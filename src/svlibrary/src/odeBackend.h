@@ -0,0 +1,96 @@
+/****************************************************/
+//Description:  PhysicsBackend using Open Dynamics Engine (the default backend).  Every model is a trimesh body.
+/****************************************************/
+
+#include "physicsBackend.h"
+#include <ode/ode.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <utility>
+#ifndef ODEBACKEND_H
+#define ODEBACKEND_H
+
+#define GPB 3  // maximum number of geometries per body
+
+
+/* an ODE body and the geoms attached to it */
+struct OdeBody {
+  dBodyID body;                          // the body of the object
+  dGeomID geom[GPB];                     // geometries representing this body
+  dReal matrix_dblbuff[ 16 * 2 ];        // double buffered matrices for 'last transform' setup (not sure what this does, it was from ODE trimesh demo)
+  int last_matrix_index;                 // has to do with double buffered matrices (not sure what this does, it was from ODE trimesh demo)
+};
+
+
+class OdeBackend : public PhysicsBackend{
+    public:
+        OdeBackend();
+        ~OdeBackend();
+
+        PhysicsBackend* emptyCopy() const;
+        int  createBody(const float *vertices, int vertCount, const int *indices, int triCount, double density);
+        void destroyBody(int body);
+        void setPose(int body, const double position[3], const double R[12]);
+        void getPose(int body, double position[3], double R[12]);
+        double getMass(int body);
+        void getVelocity(int body, double linear[3], double angular[3]);
+        const std::vector<BackendContact>& generateContacts();
+        void step(double timestep, int iterations);
+        void setGravity(double x, double y, double z);
+        void setGroundPlane(double a, double b, double c, double d);
+        void setCollisionGroup(int body, int group);
+        void setEnabled(int body, bool enabled);
+        void setAsleep(int body);
+        void configure(const BackendSettings &settings);
+        bool setSupportSurface(const double *heights, int widthSamples, int depthSamples, double width, double depth,
+                               double thickness, const double position[3], const double R[12]);
+        bool updateSupportSurface();
+        void clearSupportSurface();
+
+        /* used by ODE's collision callbacks */
+        void collide(dGeomID o1, dGeomID o2);
+        void addContacts(dGeomID o1, dGeomID o2, dContactGeom *geoms, int numc);
+        void collectPair(dGeomID o1, dGeomID o2);
+        void collidePairs();
+        void collideWorker();
+
+    private:
+        void setHeightfieldBounds();
+        void parallelCollide();
+        void stopCollideWorkers();
+
+        dWorldID world;                          //define the world in which simulation takes place
+        dSpaceID space;                          //define the space in which simulation takes place
+        dJointGroupID contactgroup;              //define the contactgroup in which objects have their contacts
+        dGeomID ground;                          //the ground plane
+        dThreadingThreadPoolID pool;             //used for ODE's threating functions
+        dThreadingImplementationID threading;    //used for ODE's threating functions
+        std::vector<OdeBody> bodies;             //every body made by createBody(), a destroyed one has no body or geoms
+        std::vector<int> freeBodies;             //handles of destroyed bodies, reused by createBody()
+        std::vector<BackendContact> contacts;    //contacts found by the last generateContacts()
+        std::vector<dContactGeom> contactBuffer; //MAX_CONTACTS slots for dCollide in the single threaded path
+        BackendSettings settings;                //parameters from SceneValidator
+
+        //support surface made from a height grid, replaces the ground plane while it exists
+        dGeomID heightfield;
+        dHeightfieldDataID heightfieldData;
+        const double *heightfieldHeights;        //ODE references (does not copy) these
+        int heightfieldSamples;
+
+        //parallel narrowphase, see parallelCollide()
+        std::vector< std::pair<dGeomID,dGeomID> > candidatePairs;  //pairs found by the broadphase this step
+        std::vector<dContactGeom> pairContacts;                    //maxContacts slots per candidate pair
+        std::vector<int> pairContactCount;                         //number of contacts dCollide found for each pair
+        std::atomic<int> nextPair;                                 //next pair to be handed to a thread
+        std::vector<std::thread> collideWorkers;                   //collideThreads-1 helper threads, the calling thread works too
+        std::mutex collideMutex;
+        std::condition_variable collideWake, collideDone;
+        int  collideRound;                                         //incremented to wake the helpers for a new step
+        int  collideBusy;                                          //helpers still working on the current round
+        bool collideQuit;                                          //tells helpers to exit
+};
+
+#endif
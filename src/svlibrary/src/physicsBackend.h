@@ -0,0 +1,101 @@
+/****************************************************/
+//Description:  The interface between SceneValidator and the physics engine that simulates a scene.  SceneValidator
+//              only ever creates bodies, sets and reads their poses, asks for contacts and steps the world through
+//              this interface, so engines can be swapped with SceneValidator::setBackend().
+//              OdeBackend (Open Dynamics Engine) is the default. ImpulseBackend is a small built in solver for
+//              scenes of a few objects mostly at rest.
+/****************************************************/
+
+#include <vector>
+#include <string>
+#ifndef PHYSICSBACKEND_H
+#define PHYSICSBACKEND_H
+
+#define COLLISION_GROUPS 32  // collision groups every backend supports (ODE's category bits)
+
+
+/* the settings SceneValidator passes to the backend before each scene, see sceneValidator.cpp for what they mean */
+struct BackendSettings {
+    double friction = 1.0;          //FRICTION_mu
+    double friction2 = 0.0;         //FRICTION_mu2
+    double bounce = 0.0;            //BOUNCE
+    double bounceVel = 0.0;         //BOUNCE_vel
+    double softCFM = 0.01;          //SOFT_CFM
+    int    maxContacts = 64;        //MAX_CONTACTS
+    double maxCorrectingVel = 0;    //MAX_CORRECTING_VEL, 0 means no limit
+    int    collideThreads = 1;      //COLLIDE_THREADS
+};
+
+/* A contact point found by the collision detection. body1 is pushed out along normal by depth (body2 the opposite way).
+   A body of -1 is the ground plane or support surface */
+struct BackendContact {
+    int    body1;
+    int    body2;
+    double pos[3];
+    double normal[3];
+    double depth;
+};
+
+
+class PhysicsBackend{
+    public:
+        virtual ~PhysicsBackend() {}
+
+        /* Makes a new backend of the same kind with no bodies, for a worker thread which needs its own world (see
+           SceneValidator::isValidSceneAsync()). Gravity, ground and settings are given to it the usual way */
+        virtual PhysicsBackend* emptyCopy() const = 0;
+
+        /* Makes a body from a triangle mesh whose center of mass is at (0,0,0) and returns its handle (0, 1, 2...).
+           vertices has 3 floats per vertex, indices 3 ints per triangle. The arrays must stay alive as long as the body */
+        virtual int createBody(const float *vertices, int vertCount, const int *indices, int triCount, double density) = 0;
+
+        /* Removes a body and frees everything the backend made for it. Afterwards its mesh arrays are no longer used, and
+           its handle may be given to a later createBody() */
+        virtual void destroyBody(int body) = 0;
+
+        /* Sets a body's pose and zeroes its velocity. R is a 3x4 row major rotation matrix (ODE's dMatrix3 layout, the 4th column is unused) */
+        virtual void setPose(int body, const double position[3], const double R[12]) = 0;
+
+        /* Gets a body's pose, R in the same layout as setPose() */
+        virtual void getPose(int body, double position[3], double R[12]) = 0;
+
+        /* Gets a body's mass */
+        virtual double getMass(int body) = 0;
+
+        /* Gets a body's linear and angular velocity */
+        virtual void getVelocity(int body, double linear[3], double angular[3]) = 0;
+
+        /* Runs collision detection for the bodies' current poses. The contacts are used by the next step(), calling it again
+           without stepping replaces them */
+        virtual const std::vector<BackendContact>& generateContacts() = 0;
+
+        /* Advances the world by timestep using the contacts from generateContacts() and the given number of solver iterations */
+        virtual void step(double timestep, int iterations) = 0;
+
+        virtual void setGravity(double x, double y, double z) = 0;
+
+        /* the ground plane a*x+b*y+c*z = d, (a,b,c) must have length 1 */
+        virtual void setGroundPlane(double a, double b, double c, double d) = 0;
+
+        /* Bodies only collide with bodies of the same group (0 to COLLISION_GROUPS-1) and with the ground. New bodies are in group 0 */
+        virtual void setCollisionGroup(int body, int group) = 0;
+
+        /* A disabled body doesn't move and nothing collides with it. New bodies are enabled */
+        virtual void setEnabled(int body, bool enabled) = 0;
+
+        /* Puts a body to sleep: it stays where it is, but still collides, until an awake body touches it.
+           setEnabled(body, true) wakes it up */
+        virtual void setAsleep(int body) = 0;
+
+        /* called before every scene with the current parameters */
+        virtual void configure(const BackendSettings &settings) = 0;
+
+        /* Optional: replace the ground plane with a heightfield (see SceneValidator::setSupportSurface()). heights must stay
+           alive while the surface is used. R and position place the grid's center, in the layout of setPose() */
+        virtual bool setSupportSurface(const double *heights, int widthSamples, int depthSamples, double width, double depth,
+                                       double thickness, const double position[3], const double R[12]) { return false; }
+        virtual bool updateSupportSurface() { return false; }
+        virtual void clearSupportSurface() {}
+};
+
+#endif
@@ -0,0 +1,169 @@
+/****************************************************/
+//Description:  Logistic regression pre-classifier, see preClassifier.h.  The weights are fitted with Newton's method
+//              (iteratively reweighted least squares) and a little L2 regularisation, which takes a few milliseconds for
+//              a log of thousands of scenes since there are only PRECLASSIFIER_FEATURES+1 weights.
+/****************************************************/
+
+#include "preClassifier.h"
+#include <cmath>                  //used for exp and sqrt
+#include <fstream>                //used to save and load the weights
+#include <algorithm>              //used for sort
+#include <Eigen/Dense>            //used to solve the Newton steps
+
+using namespace std;
+
+#define NEWTON_ITERATIONS 50      // most Newton steps when fitting the weights
+#define REGULARISATION 1e-3       // L2 penalty on the weights (not the bias), keeps separable logs from blowing up
+
+
+PreClassifier::PreClassifier() : acceptAbove(2), rejectBelow(-1){  //decides nothing until it is trained
+}
+
+
+/* weights applied to the standardised features */
+static double score(const vector<double> &weights, const vector<double> &mean, const vector<double> &scale, const double *features){
+  double s = weights[PRECLASSIFIER_FEATURES];
+  for (int k = 0; k < PRECLASSIFIER_FEATURES; k++){
+    s += weights[k] * (features[k] - mean[k]) / scale[k];
+  }
+  return s;
+}
+
+
+bool PreClassifier::train(const vector< vector<double> > &features, const vector<bool> &verdicts,
+                          double falseRejectRate, double falseAcceptRate){
+  //every fifth scene is kept for the calibration
+  vector<int> fit, calibrate;
+  for (int i = 0; i < features.size(); i++){
+    (i % 5 == 4 ? calibrate : fit).push_back(i);
+  }
+  int validFit = 0;
+  for (int i = 0; i < fit.size(); i++) validFit += verdicts[fit[i]];
+  if (features.size() != verdicts.size() || calibrate.empty() || validFit == 0 || validFit == fit.size()){
+    return false;
+  }
+
+  //standardise the features so one regularisation fits all of them
+  mean.assign(PRECLASSIFIER_FEATURES, 0);
+  scale.assign(PRECLASSIFIER_FEATURES, 0);
+  for (int i = 0; i < fit.size(); i++){
+    for (int k = 0; k < PRECLASSIFIER_FEATURES; k++) mean[k] += features[fit[i]][k] / fit.size();
+  }
+  for (int i = 0; i < fit.size(); i++){
+    for (int k = 0; k < PRECLASSIFIER_FEATURES; k++) scale[k] += pow(features[fit[i]][k] - mean[k], 2) / fit.size();
+  }
+  for (int k = 0; k < PRECLASSIFIER_FEATURES; k++){
+    scale[k] = sqrt(scale[k]) > 1e-9 ? sqrt(scale[k]) : 1;  //a feature which never changes is left as it is
+  }
+
+  //Newton's method on the regularised log likelihood
+  const int n = PRECLASSIFIER_FEATURES + 1;
+  Eigen::VectorXd w = Eigen::VectorXd::Zero(n);
+  for (int iteration = 0; iteration < NEWTON_ITERATIONS; iteration++){
+    Eigen::VectorXd gradient = REGULARISATION * w;
+    Eigen::MatrixXd hessian = REGULARISATION * Eigen::MatrixXd::Identity(n, n);
+    gradient[n-1] = 0;
+    hessian(n-1, n-1) = 1e-9;
+    for (int i = 0; i < fit.size(); i++){
+      Eigen::VectorXd x(n);
+      for (int k = 0; k < PRECLASSIFIER_FEATURES; k++) x[k] = (features[fit[i]][k] - mean[k]) / scale[k];
+      x[n-1] = 1;
+      double p = 1 / (1 + exp(-w.dot(x)));
+      gradient += (p - (verdicts[fit[i]] ? 1 : 0)) * x;
+      hessian += p * (1 - p) * x * x.transpose();
+    }
+    Eigen::VectorXd step = hessian.ldlt().solve(gradient);
+    w -= step;
+    if (step.norm() < 1e-8) break;
+  }
+  weights.assign(w.data(), w.data() + n);
+
+  //thresholds from the held back scenes
+  vector<double> valid, invalid;
+  for (int i = 0; i < calibrate.size(); i++){
+    double p = probability(features[calibrate[i]].data());
+    (verdicts[calibrate[i]] ? valid : invalid).push_back(p);
+  }
+  sort(valid.begin(), valid.end());                  //lowest first
+  sort(invalid.begin(), invalid.end());
+  reverse(invalid.begin(), invalid.end());           //highest first
+  //no valid scene is rejected unless falseRejectRate allows at least one, the same for accepting invalid ones
+  int rejected = (int)(falseRejectRate * valid.size());
+  int accepted = (int)(falseAcceptRate * invalid.size());
+  rejectBelow = valid.empty() ? 0 : valid[std::min(rejected, (int)valid.size()-1)];
+  acceptAbove = invalid.empty() ? 1 : invalid[std::min(accepted, (int)invalid.size()-1)];
+  return true;
+}
+
+
+double PreClassifier::probability(const double *features) const{
+  if (!trained()){
+    return 0.5;
+  }
+  return 1 / (1 + exp(-score(weights, mean, scale, features)));
+}
+
+
+int PreClassifier::classify(const double *features) const{
+  if (!trained()){
+    return -1;
+  }
+  double p = probability(features);
+  if (p > acceptAbove){
+    return 1;
+  }
+  if (p < rejectBelow){
+    return 0;
+  }
+  return -1;
+}
+
+
+bool PreClassifier::save(const string &filename) const{
+  ofstream file(filename.c_str());
+  if (!file || !trained()){
+    return false;
+  }
+  file.precision(17);
+  file<<"preclassifier "<<PRECLASSIFIER_FEATURES<<endl;
+  file<<"mean";
+  for (int k = 0; k < mean.size(); k++) file<<" "<<mean[k];
+  file<<endl<<"scale";
+  for (int k = 0; k < scale.size(); k++) file<<" "<<scale[k];
+  file<<endl<<"weights";
+  for (int k = 0; k < weights.size(); k++) file<<" "<<weights[k];
+  file<<endl<<"accept "<<acceptAbove<<endl;
+  file<<"reject "<<rejectBelow<<endl;
+  return (bool)file;
+}
+
+
+bool PreClassifier::load(const string &filename){
+  ifstream file(filename.c_str());
+  string word;
+  int count;
+  if (!(file>>word>>count) || word != "preclassifier" || count != PRECLASSIFIER_FEATURES){
+    return false;
+  }
+  vector<double> m(count), s(count), w(count+1);
+  double accept, reject;
+  file>>word;
+  for (int k = 0; k < count; k++) file>>m[k];
+  file>>word;
+  for (int k = 0; k < count; k++) file>>s[k];
+  file>>word;
+  for (int k = 0; k <= count; k++) file>>w[k];
+  file>>word>>accept>>word>>reject;
+  if (!file){
+    return false;
+  }
+  mean = m;  scale = s;  weights = w;
+  acceptAbove = accept;
+  rejectBelow = reject;
+  return true;
+}
+
+
+bool PreClassifier::trained() const{
+  return weights.size() == PRECLASSIFIER_FEATURES + 1;
+}
@@ -0,0 +1,47 @@
+/****************************************************/
+//Description:  A logistic regression over a few cheap geometric features of a scene (see SceneValidator::getSceneFeatures())
+//              which decides the obvious scenes before they are simulated.  It is trained from logged (scene, verdict)
+//              pairs and its two thresholds are calibrated so that it wrongly rejects (or accepts) at most a chosen
+//              fraction of scenes.  Everything in between is left to the simulation.
+/****************************************************/
+
+#include <vector>
+#include <string>
+#ifndef PRECLASSIFIER_H
+#define PRECLASSIFIER_H
+
+#define PRECLASSIFIER_FEATURES 8  // number of features of a scene, see SceneValidator::getSceneFeatures()
+
+
+class PreClassifier{
+    public:
+        PreClassifier();
+
+        /* Fits the weights to features (PRECLASSIFIER_FEATURES per scene) and their verdicts, then calibrates the thresholds on
+           every fifth scene, which the weights aren't fitted on: at most falseRejectRate of the valid scenes fall below
+           the reject threshold and at most falseAcceptRate of the invalid ones above the accept threshold.
+           Returns false if there are too few scenes or only one kind of verdict */
+        bool train(const std::vector< std::vector<double> > &features, const std::vector<bool> &verdicts,
+                   double falseRejectRate, double falseAcceptRate);
+
+        /* Probability that a scene with these features is valid */
+        double probability(const double *features) const;
+
+        /* 1 for valid, 0 for invalid and -1 when it isn't sure and the scene has to be simulated */
+        int classify(const double *features) const;
+
+        /* Reads and writes the weights and thresholds as a small text file */
+        bool save(const std::string &filename) const;
+        bool load(const std::string &filename);
+
+        bool trained() const;
+
+    private:
+        std::vector<double> mean;          //features are standardised with these before the weights are applied
+        std::vector<double> scale;
+        std::vector<double> weights;       //PRECLASSIFIER_FEATURES weights and then the bias
+        double acceptAbove;                //valid if the probability is above this
+        double rejectBelow;                //invalid if the probability is below this
+};
+
+#endif
@@ -5,6 +5,8 @@
 //       Date:  July 2016
 //Description:  This code provides functions which can be used to check if a set of objects are in static
 //              equilibrium or not.  The method to do this relies on in Open Dynamics Engine, a physics engine.
+//              The physics engine itself is reached through PhysicsBackend (see physicsBackend.h), the ODE code is
+//              in odeBackend.cpp.
 //    Gitthub:  https://github.com/jshepley14/PhysicsEngine
 //   Glossary:
 //              "ODE": Open Dynamics Engine http://www.ode.org/
@@ -16,18 +18,34 @@
 /* headers */
 #include "sceneValidator.h"       //contains the header file for this .cpp file
 #include <map>                    //used to make hashmap
+#include <set>                    //used to keep firstValidScenes()'s valid candidates in rank order
 #include <cassert>                //used to make hashmap
-#include <ode/ode.h>              //main physics engine library
+#include <ode/ode.h>              //main physics engine library, only used here to initialize and close ODE
 #include <drawstuff/drawstuff.h>  //this is the graphics library
-#include <string.h>               //allows strings to be used
+#include <string.h>               //allows strings to be used, and memcpy
 #include <fstream>                //allows some extra printing functions
 #include <cmath>                  //allows math functions like absolute value
+#include <algorithm>              //used for std::min, std::max and std::copy
+#include <iterator>               //used for std::next
+#include <vector>                 //used for the model data
 #include <chrono>                 //used for timing code
+#include <thread>                 //used for isValidSceneAsync()'s worker threads
+#include <mutex>                  //used to guard the async queue, the validator pool and ODE's initialization
+#include <condition_variable>     //used to wake the async workers
+#include <memory>                 //used for shared_ptr
+#include <atomic>                 //used to cancel async scenes
 #include <stdio.h>                //common and neccesary c++ library
 #include <iostream>               //used for printing
 #include <Eigen/Dense>            //used for dealing with Eigen data types
 #include <Eigen/Geometry>         //used for dealing with Eigen data types
 #include "objLoader.h"            //used for parsing .obj file
+#include "odeBackend.h"           //the default physics backend
+#include "staticEquilibrium.h"    //used for the ANALYTIC check
+#include "convexHull.h"           //used for the SUPPORT_SHORTCUT check
+#include "verdictCache.h"         //used to remember verdicts of scenes which were already checked
+#include "sweepQuery.h"           //used by findPlacement() to lower an object onto the scene
+#include "preClassifier.h"        //used to decide obvious scenes without simulating them
+#include "modelStore.h"           //used to share preprocessed models between processes
 #include "texturepath.h"          //used for getting path to textures
 
 /*definitions */
@@ -47,8 +65,8 @@
 #endif
 
 // some constants
+#define SETTLE_QUIET 5               // steps in a row every object must stay below SETTLE_SPEED to count as at rest
 #define NUM 200			    // max number of objects (FYI 14 objects make program 10x slower than 2 objects and Number of Objects vs Time is linear)
-#define GPB 3		      	// maximum number of geometries per body
 using namespace std;
 
 
@@ -57,9 +75,21 @@ using namespace std;
  ---  Variables that will affect time to validate scene ---
   DRAW (rendering an image significantly slows down computation time)
   MAX_CONTACTS
+  COLLIDE_THREADS
   STEP1, STEP2, STEP3, and STEP4
   THRESHOLD 
+  ANALYTIC (and ANALYTIC_ACCEPT, ANALYTIC_REJECT)
+  SUPPORT_SHORTCUT (and SUPPORT_TOLERANCE)
+  CASCADE (and CASCADE_MARGIN)
+  COMPONENTS (and COMPONENT_FAIL_FAST)
+  CACHE_SIZE (and CACHE_GRID, CACHE_ANGLE)
+  PRECLASSIFIER
+  ASYNC_THREADS (and ASYNC_QUEUE, only for isValidSceneAsync())
+  PLACEMENT_BISECT (and PLACEMENT_TOLERANCE, only for findPlacement())
+  SETTLE_STEPS (and SETTLE_SPEED, only for settleScene())
   TIMESTEP
+  ITERATIONS
+  ADAPTIVE (and ADAPT_DEPTH, TIMESTEP_MIN, TIMESTEP_MAX, ITERATIONS_MIN, ITERATIONS_MAX)
 
  ---  Variables that affect THRESHOLD  ---
 	BOUNCE
@@ -84,40 +114,67 @@ using namespace std;
 //Variables that can be set in setParams() or in custom constructor or in setScale()
 static double BOUNCE = 0.0;            //change the bounciness
 static double BOUNCE_vel = 0.0;        //change the bounciness speed
+static bool   ANALYTIC = false;        //first try to decide the scene from its contact forces without simulating, see analyticCheck()
+static double ANALYTIC_ACCEPT = 0.01;  //when ANALYTIC, the scene is valid if no body has more than this fraction of its weight left unbalanced
+static double ANALYTIC_REJECT = 0.1;   //when ANALYTIC, the scene is invalid if a touching body has more than this fraction left unbalanced. In between it's simulated
+static bool   CASCADE = false;         //simulate with oriented bounding boxes first, then convex hulls, and only use the full trimesh for close calls, see cascadeScene()
+static double CASCADE_MARGIN = 0.03;   //when CASCADE, a coarse tier only decides a scene if every object moved less than THRESHOLD-CASCADE_MARGIN (valid) or one moved more than THRESHOLD+CASCADE_MARGIN (invalid)
+static bool   COMPONENTS = false;      //split the scene into groups of objects which can't reach each other and check each group on its own, see componentScenes()
+static bool   COMPONENT_FAIL_FAST = true; //when COMPONENTS, stop at the first invalid group instead of checking the rest
+static int    CACHE_SIZE = 0;          //how many verdicts to remember, 0 turns the cache off. Changing any parameter empties the cache
+static double CACHE_GRID = 0.001;      //scenes whose object positions round to the same multiple of this share a cached verdict, 0 means exact
+static double CACHE_ANGLE = 0.005;     //same as CACHE_GRID for the entries of the rotation matrices
+static int    ASYNC_THREADS = 2;       //worker threads (each with its own world) running isValidSceneAsync(), read when the first async scene is queued
+static int    ASYNC_QUEUE = 64;        //most scenes waiting for a worker, isValidSceneAsync() blocks until there is room
+static bool   PRECLASSIFIER = false;   //let the classifier from loadPreClassifier() decide the scenes it is sure about before simulating them
+static bool   ADAPTIVE = false;        //let the timestep and solver iterations follow how much is happening in the scene, see adaptStep()
+static double ADAPT_DEPTH = 0.01;      //when ADAPTIVE, a contact deeper than this (or a body moving further than this in one step) makes the steps smaller
+static int    COLLIDE_THREADS = 1;     //number of threads running the narrowphase (dCollide) each step in OdeBackend. 1 uses the original single threaded nearCallback
 static double DEFAULT_SCALE = 100;     //The default value each .obj files data is scaled down by. Set scale in setScale
 static double DENSITY = 5.0;           //The default is from ODE trimesh demo
 static bool   DRAW = false;            //used to switch on or off the drawing of the scene
 static double FRICTION_mu =  1.0;      //if you set this to 0 objects will be very slippery
 static double FRICTION_mu2 =  0.0;     //changing this doesn't seem to do much
 static int    MAX_CONTACTS = 64;       //maximum number of contact points per body
+static double MAX_CORRECTING_VEL = 0;  //limits how fast ODE pushes penetrating objects apart, 0 means no limit (ODE's default). Around 1 helps when using -9.8 gravity
+static int    ITERATIONS = 20;         //number of QuickStep solver iterations per step (20 is ODE's default). When ADAPTIVE this is the starting value
+static int    ITERATIONS_MIN = 5;      //when ADAPTIVE, fewest solver iterations used while the scene is quiet
+static int    ITERATIONS_MAX = 60;     //when ADAPTIVE, most solver iterations used while contacts are violent
 static double GRAVITYx = 0;            //gravitational force coming from x direction
 static double GRAVITYy = 0;            //gravitational force coming from y direction
-static double GRAVITYz = -0.5;         //yes, this is not -9.8, but this was the default that ODE trimesh demo had. Using -9.8 in this program prevents accuracy unless you change other variables like TIMESTEP
+static double GRAVITYz = -0.5;         //yes, this is not -9.8, but this was the default that ODE trimesh demo had. Using -9.8 in this program prevents accuracy unless you change other variables like TIMESTEP or turn on ADAPTIVE
+static double HEIGHTFIELD_THICKNESS = 1.0; //how far below its lowest sample a heightfield support surface stays solid, stops objects from tunneling through it
 static double PLANEa = 0;              //Equation of a plane: a*x+b*y+c*z = d The normal vector must have length 1
 static double PLANEb = 0;
 static double PLANEc = 1;
 static double PLANEd = 0;
+static bool   PLACEMENT_BISECT = false;//findPlacement() brackets the resting height with the backend's collision detection instead of sweeping the trimeshes, see findPlacement()
+static double PLACEMENT_TOLERANCE = 0.005; //when PLACEMENT_BISECT, contacts shallower than this don't count as penetrating and the bisection stops once the bracket is this small
 static bool   PRINT_AABB = false;      //print the object's Bounding Box
 static bool   PRINT_CHKR_RSLT = false; //print the result of check1, check2 etc..
 static bool   PRINT_COM = false;       //print the object's center of mass
 static bool   PRINT_DELTA_POS = false; //print an object's delta x,y,z for its center
 static bool   PRINT_END_POS   = false; //print an object's final x,y,z center
 static bool   PRINT_START_POS = false; //print an object's intial x,y,z center
+static bool   SUPPORT_SHORTCUT = false;//decide objects which only touch the ground plane with the support polygon test instead of simulating them, see supportCheck()
+static double SUPPORT_TOLERANCE = 0.01;//when SUPPORT_SHORTCUT, hull vertices this close to the plane support the object, and a center of mass this close to the support polygon's edge is left to the simulation
 static double SOFT_CFM = 0.01;         //makes "system more numerically robust" according to ODE manual. Not 100% sure what it does... The current number is from a default demo.
+static int    SETTLE_STEPS = 500;      //most simulation steps settleScene() runs while waiting for the scene to come to rest
+static double SETTLE_SPEED = 0.01;     //settleScene() calls a scene at rest once no object's points move faster than this for SETTLE_QUIET steps in a row
 static int    STEP1=6;                 //amount of simulation steps used in check #1
 static int    STEP2=14;                //amount of simulation steps used in check #2
 static int    STEP3=20;                //amount of simulation steps used in check #3
 static int    STEP4=110;               //amount of simulation steps used in check #4
 static double THRESHOLD  = 0.08;       //amount objects allowed to move while still being marked as in static equilibrium
-static double TIMESTEP = 0.05;         //controls how far each physics simulation step is taken
+static double TIMESTEP = 0.05;         //controls how far each physics simulation step is taken. When ADAPTIVE this is the starting value
+static double TIMESTEP_MIN = 0.005;    //when ADAPTIVE, smallest timestep used while contacts are violent
+static double TIMESTEP_MAX = 0.1;      //when ADAPTIVE, largest timestep used while the scene is quiet
 
 
 
 //variables used when DRAW = true
 float  xyz[3]={ -0.0559,  -8.2456, 6.0500};  //this sets the x,y,z of the camera position when you view a drawing
 float  hpr[3]={ 89.0000, -25.0000, 0.0000};  //this sets the heading, pitch and roll numbers in degrees(camera angle) of the camera when you view a drawing
-static int    counter=0;    //used within simulation to count until dsSTEP, indicates termination of drawing window
-static int    dsSTEP=100;   //default simulation step number when drawing a scene. To change dsSTEP, just change STEP1,2,3 or 4.
 static int    HEIGHT=500;   //window height
 static int    WIDTH=1000;   //window width
 
@@ -129,19 +186,23 @@ static chrono::steady_clock::time_point startTime, endTime;
 /* dynamics and collision object (this is the model's data) */
 
 struct MyObject {
-  dBodyID body;			                     // the body of the object
-  dGeomID geom[GPB];                     // geometries representing this body
-  dReal matrix_dblbuff[ 16 * 2 ];        // double buffered matrices for 'last transform' setup (not sure what this does, it was from ODE trimesh demo)
-  int last_matrix_index;                 // has to do with double buffered matrices (not sure what this does, it was from ODE trimesh demo) 
+  int body;                              // the object's body in the physics backend
   string model_ID;                       //model's I.D.      
-  dReal center[3];                       //the center x,y,z coordinates
+  double center[3];                      //the center x,y,z coordinates
   int indCount;                          //number of triangles (indices)
   int vertCount;                         //number of vertices
-  vector< vector<int> > indexDrawVec;    //index list for Trimesh, but only used when drawing the Trimesh
-  vector<int> indexGeomVec;              //index list for the Trimesh, used all the time for Trimesh
-  vector<float> vertexDrawVec;           //vertex list for Trimesh, but only used when drawing the Trimesh
-  vector<float> vertexGeomVec;           //vetex list for the Trimesh, used all the time for Trimesh
+  vector<int> indexGeomVec;              //index list for the Trimesh, when it was loaded from a .obj file
+  vector<float> vertexGeomVec;           //vetex list for the Trimesh, when it was loaded from a .obj file
+  const int *indices;                    //the Trimesh's indices (3 per triangle) used for everything, in indexGeomVec or a model store
+  const float *vertices;                 //the Trimesh's vertices (3 floats each) used for everything, in vertexGeomVec or a model store
+  std::shared_ptr<ModelStore> store;     //the model store the Trimesh is in, keeps it mapped
   vector<float> centerOfMass;            //center of mass x,y,z
+  double radius;                         //distance from the center of mass to the furthest vertex
+  vector<Eigen::Vector3d> hullVertices;  //corners of (an approximation of) the convex hull, relative to the center of mass
+  vector<float> boxVertices;             //oriented bounding box as a trimesh, used by CASCADE
+  vector<int>   boxIndices;
+  vector<float> hullMeshVertices;        //the convex hull as a trimesh, used by CASCADE
+  vector<int>   hullMeshIndices;
 };
 
 // this class is for center of mass calculations
@@ -154,57 +215,73 @@ public:
 };
 
 //more variables, not really parameters though
-static int num=0;	                         //number of objects in simulation
-static int nextobj=0;		                   //next object to recycle if num==NUM
-static dWorldID world;                     //define the world in which simulation takes place
-static dSpaceID space;                     //define the space in which simulation takes place
-static MyObject obj[NUM];                  //array of MyObject's
-static dJointGroupID contactgroup;         //define the contactgroup in which objects have their contacts
 static int show_contacts = 0;	             //show contact points
 static int random_pos = 1;	               //drop objects from random position?
-static std::map<std::string, MyObject> m;  //hashmap of object names and their MyObject data
-typedef dReal dVector3R[3];                //probably don't need this
-static double scaling[NUM];                //array to be filled with scaling info for each object
 
 
+/* an object of the committed scene, see commitScene() */
+struct CommittedObject {
+  string model_ID;
+  double center[3];                        //settled position
+  double R[12];                            //settled rotation
+};
 
-/*functions are below*/
 
-/* Handles objects' collisions (makes a termporary joint)
-   This is called by dSpaceCollide when two objects in space are potentially colliding. 
-   I did not alter this function from ODE trimesh demo except for the parameter values. */
-static void nearCallback (void *, dGeomID o1, dGeomID o2)
-{
-  int i;
-  // exit without doing anything if the two bodies are connected by a joint
-  dBodyID b1 = dGeomGetBody(o1);
-  dBodyID b2 = dGeomGetBody(o2);
-  if (b1 && b2 && dAreConnectedExcluding (b1,b2,dJointTypeContact)) return;
-
-  //set parameters for each contact on the object
-  dContact contact[MAX_CONTACTS];   // up to MAX_CONTACTS contacts per box-box
-  for (i=0; i<MAX_CONTACTS; i++) {
-    contact[i].surface.mode = dContactBounce | dContactSoftCFM;
-    contact[i].surface.mu = FRICTION_mu;
-    contact[i].surface.mu2 = FRICTION_mu2;
-    contact[i].surface.bounce = BOUNCE;
-    contact[i].surface.bounce_vel = BOUNCE_vel;
-    contact[i].surface.soft_cfm = SOFT_CFM;
-  }
-
-  //execute collision force (temporary joint)
-  if (int numc = dCollide (o1,o2,MAX_CONTACTS,&contact[0].geom,
-			   sizeof(dContact))) {
-    dMatrix3 RI;
-    dRSetIdentity (RI);
-    const dReal ss[3] = {0.02,0.02,0.02};
-    for (i=0; i<numc; i++) {
-      dJointID c = dJointCreateContact (world,contactgroup,contact+i);
-      dJointAttach (c,b1,b2);
-      if (show_contacts) dsDrawBox (contact[i].geom.pos,RI,ss);
-    }
-  }
-}
+/* Everything that belongs to one SceneValidator's simulation, so several SceneValidators can exist at once.
+   The parameters above are shared by all SceneValidators */
+struct SimWorld {
+  PhysicsBackend *backend;                 //the physics engine, OdeBackend unless setBackend() was called
+  double gravity[3];                       //gravity given to the constructor
+  double plane[4];                         //ground plane a*x+b*y+c*z = d given to the constructor
+  int num;                                 //number of objects in simulation
+  int numModels;                           //number of models loaded by setModels()
+  MyObject obj[NUM];                       //array of MyObject's
+  std::map<std::string, MyObject> m;       //hashmap of object names and their MyObject data
+  double scaling[NUM];                     //array to be filled with scaling info for each object
+  SimulationStats stats;                   //steps, timesteps and iterations used by the last isValidScene() call
+  double stepSize;                         //timestep used for the next simulation step
+  int    stepIterations;                   //solver iterations used for the next simulation step
+  double stepMaxDepth;                     //deepest contact found in this step's collision detection
+  vector<int> stepBodies;                  //bodies of the scene being simulated, adaptStep() watches how fast they move
+  int    counter;                          //used within simulation to count until dsSTEP, indicates termination of drawing window
+  int    dsSTEP;                           //simulation step number when drawing a scene. To change dsSTEP, just change STEP1,2,3 or 4.
+  double dsTIME;                           //same as dsSTEP but in simulated seconds, used instead of dsSTEP when ADAPTIVE
+  vector<double> heightfieldHeights;       //height samples of the support surface. The backend references (does not copy) these so updateSupportSurface() can rewrite them in place
+  int heightfieldSamples[2];               //the rest of the support surface's setSupportSurface() arguments, so async workers can make the same one
+  double heightfieldSize[2];
+  Eigen::Matrix3d heightfieldRotation;
+  Eigen::Vector3d heightfieldPosition;
+  vector<string> modelNames;               //setModels()'s arguments, so async workers can load the same models
+  vector<string> modelFiles;
+  vector<int> handleMark;                  //used by the handle isValidScene() to find repeated handles without allocating
+  int handleScene;                         //counts handle isValidScene() calls, a handle is used twice if its mark equals this
+  const std::atomic<bool> *cancel;         //set while an async scene runs, the simulation stops when it becomes true
+  int  stepBudget;                         //most simulation steps the current call may take, 0 for no limit
+  bool hasDeadline;                        //the current call has to be finished by deadline
+  chrono::steady_clock::time_point deadline;
+  bool stoppedEarly;                       //the current scene was cancelled or ran out of budget, see stopped()
+  std::map<std::string, vector<int> > copyBodies;  //extra bodies of each model used by isValidScenes(), copyBodies[name][k-1] is the model in hypothesis k
+  std::map<std::string, vector<int> > tierBodies;  //coarse bodies of each model used by CASCADE, [0] is the bounding box and [1] the hull
+  CascadeStats cascade;                    //scenes decided by each CASCADE tier
+  vector<ComponentVerdict> components;     //groups of objects checked by the last isValidScene() when COMPONENTS
+  VerdictCache cache;                      //verdicts of whole scenes and of groups of objects
+  vector<CommittedObject> committed;       //the scene kept by commitScene(), at the poses where it settled
+  FailureReport report;                    //which objects failed in the last isValidScene() or isValidWithCommitted()
+  vector<string> reportNames;              //the scene being reported on, empty when no report is being made
+  std::map<int,int> reportBodies;          //body handle -> index into reportNames, coarse CASCADE bodies included
+  PreClassifier preClassifier;             //decides obvious scenes when PRECLASSIFIER, see loadPreClassifier()
+  int reportSteps;                         //steps whose contacts went into the support graph, it's only taken from the first STEP1 steps
+  std::map<std::string, Eigen::Vector3d> symmetryAxes;  //rotation about these (model frame) axes doesn't change a model, see setSymmetryAxis()
+  int cacheGeneration;                     //paramGeneration when the cached verdicts were made
+};
+
+static std::once_flag odeInitialized;      //ODE is initialized once per process, by the first SceneValidator, and never closed while the process runs
+static int paramGeneration = 0;            //changes whenever setParams() sets a parameter which can change verdicts, cached verdicts from before are thrown out
+static SimWorld *drawWorld = 0;            //the world being drawn, drawstuff's callbacks can't be given it any other way
+
+
+
+/*functions are below*/
 
 /* user can set viewpoint (camera angle) */
 bool SceneValidator::setCamera(float x, float y, float z, float h, float p, float r){
@@ -223,21 +300,124 @@ static void start(){
 }
 
 
+/* "up" for findPlacement() and the support graph: against gravity, or along the ground plane's normal without gravity */
+static Eigen::Vector3d upDirection(SimWorld &w){
+    Eigen::Vector3d up(-w.gravity[0], -w.gravity[1], -w.gravity[2]);
+    if (up.norm() < 1e-12){
+      up = Eigen::Vector3d(w.plane[0], w.plane[1], w.plane[2]);
+    }
+    return up.normalized();
+}
+
+
+/* Starts the FailureReport of a scene whose objects have been put at their starting poses */
+static void startReport(SimWorld &w, const std::vector<string> &modelnames){
+    w.report = FailureReport();
+    w.report.objects.resize(modelnames.size());
+    w.reportNames = modelnames;
+    w.reportBodies.clear();
+    w.reportSteps = 0;
+    for (int i = 0; i < modelnames.size(); i++){
+      w.reportBodies[w.m.find(modelnames[i])->second.body] = i;
+    }
+}
+
+
+/* index of an object in the report, -1 if it isn't in it (or no report is being made) */
+static int reportIndex(SimWorld &w, const string &name){
+    vector<string>::iterator found = std::find(w.reportNames.begin(), w.reportNames.end(), name);
+    return found == w.reportNames.end() ? -1 : found - w.reportNames.begin();
+}
+
+
+/* marks an object as failed, the first one marked is the culprit */
+static void noteFailure(SimWorld &w, const string &name){
+    int i = reportIndex(w, name);
+    if (i < 0){
+      return;
+    }
+    w.report.objects[i].failed = true;
+    if (w.report.culprit < 0){
+      w.report.culprit = i;
+    }
+}
+
+
+/* Adds the support edges of the current contacts to the report. A contact whose normal is mostly along "up" means the
+   body it pushes up rests on the other one */
+static void recordSupport(SimWorld &w, const vector<BackendContact> &contacts){
+    Eigen::Vector3d up = upDirection(w);
+    for (int c = 0; c < contacts.size(); c++){
+      double along = up.dot(Eigen::Vector3d(contacts[c].normal[0], contacts[c].normal[1], contacts[c].normal[2]));
+      if (std::abs(along) < 0.5){  //a contact on the side, nothing is held up by it
+        continue;
+      }
+      int upper = along > 0 ? contacts[c].body1 : contacts[c].body2;
+      int lower = along > 0 ? contacts[c].body2 : contacts[c].body1;
+      std::map<int,int>::iterator u = w.reportBodies.find(upper);
+      if (upper < 0 || u == w.reportBodies.end()){
+        continue;
+      }
+      int below = -1;
+      if (lower >= 0){
+        std::map<int,int>::iterator l = w.reportBodies.find(lower);
+        if (l == w.reportBodies.end()) continue;
+        below = l->second;
+      }
+      vector<int> &restsOn = w.report.objects[u->second].restsOn;
+      if (std::find(restsOn.begin(), restsOn.end(), below) == restsOn.end()){
+        restsOn.push_back(below);
+      }
+    }
+}
+
+
+/* records how far the objects' bodies are from where they started */
+static void noteDisplacements(SimWorld &w, const std::vector<string> &modelnames){
+    for (int i = 0; i < modelnames.size(); i++){
+      int index = reportIndex(w, modelnames[i]);
+      if (index < 0){
+        continue;
+      }
+      MyObject &object = w.m.find(modelnames[i])->second;
+      double pos[3], R[12];
+      w.backend->getPose(object.body, pos, R);
+      ObjectReport &report = w.report.objects[index];
+      for (int k = 0; k < 3; k++){
+        report.displacement = std::max(report.displacement, std::abs(pos[k] - object.center[k]));
+      }
+      if (report.displacement > THRESHOLD){
+        report.failed = true;
+      }
+    }
+}
+
+
+/* Fills in how far every object moved and ends the report */
+static void finishReport(SimWorld &w, const std::vector<string> &modelnames){
+    noteDisplacements(w, modelnames);
+    w.reportNames.clear();
+    w.reportBodies.clear();
+}
+
+
 /* after a certaint number of simulation steps, checks if an object from a the scene is valid or not */
-static bool inStaticEquilibrium(MyObject &object){
-    double startX = object.center[0];                  //get the object's initial x pos.
-    double startY = object.center[1];                  //get the object's initial y pos.
-    double startZ = object.center[2];                  //get the object's initial z pos.
-    double endX = dBodyGetPosition(object.body)[0];    //get the object's final x pos.
-    double endY = dBodyGetPosition(object.body)[1];    //get the object's final y pos.
-    double endZ = dBodyGetPosition(object.body)[2];    //get the object's final z pos.
+static bool inStaticEquilibrium(SimWorld &w, int body, const double center[3], const string &model_ID){
+    double endPos[3], endR[12];
+    w.backend->getPose(body, endPos, endR);            //get the object's final pose
+    double startX = center[0];                         //get the object's initial x pos.
+    double startY = center[1];                         //get the object's initial y pos.
+    double startZ = center[2];                         //get the object's initial z pos.
+    double endX = endPos[0];                           //get the object's final x pos.
+    double endY = endPos[1];                           //get the object's final y pos.
+    double endZ = endPos[2];                           //get the object's final z pos.
     double deltaX = std::abs(startX - endX);           //calculate change in x
     double deltaY = std::abs(startY - endY);           //calculate change in y
     double deltaZ = std::abs(startZ - endZ);           //calculate change in z
 
     //some if statements for if you want to print out what's happening
     if (PRINT_START_POS || PRINT_END_POS || PRINT_DELTA_POS){
-      cout<<object.model_ID<<endl;
+      cout<<model_ID<<endl;
     }
     if (PRINT_START_POS){
       cout<<"Start: "<<startX<<", "<<startY<<", "<<startZ<<endl;
@@ -262,11 +442,12 @@ static bool inStaticEquilibrium(MyObject &object){
 
 /* after a certaint number of simulation steps, checks if a scene is valid or not
 by iterating through the list of objects and checking if any of the object's moved too far */
-static bool isValid(std::vector<string> modelnames){
+static bool isValid(SimWorld &w, std::vector<string> modelnames){
     bool stable = true;  //bool that says scene is stable (valid) or not
-    for (int i=0; i<num; i++){  //iterate through hashmap of modelnames that correspond to objects
-       auto mappedObject= m.find(modelnames[i]);
-       if (!inStaticEquilibrium(mappedObject->second) ){  //check if an object has moved too much (beyond threshold)
+    for (int i=0; i<w.num; i++){  //iterate through hashmap of modelnames that correspond to objects
+       auto mappedObject= w.m.find(modelnames[i]);
+       if (!inStaticEquilibrium(w, mappedObject->second.body, mappedObject->second.center, mappedObject->second.model_ID) ){  //check if an object has moved too much (beyond threshold)
+          noteFailure(w, modelnames[i]);
           stable = false;
           break;
        }
@@ -292,6 +473,9 @@ static bool isValid(std::vector<string> modelnames){
 void setObject (MyObject &object, double number, char* filename){
 
   double SCALE = number; //set the scale, or else object will be too big or too small, can set the scale manually if you want in setScale()
+  object.indexGeomVec.clear();   //the object may have held another model
+  object.vertexGeomVec.clear();
+  object.store.reset();
 
   //Load the file
   objLoader *objData = new objLoader();     //this objLoader code relies on objLoader.h and it's dependencies
@@ -335,20 +519,10 @@ void setObject (MyObject &object, double number, char* filename){
 
   //Now get all the data from the .obj file (faces and vertices)
   //and put it in vectors so ODE can make a trimesh out of that data.
-  //vectors "for drawing" have the same data as vectors "for geometry",
-  //but it's more manageable to have seperate vectors when DRAW = true and when DRAW = false
-
-  //Make 2D vector of indices for drawing
-  int indexCount = object.indCount;
-	for(int i=0; i<indexCount; i++)
-	{	vector<int> temp_vec;
-		temp_vec.push_back((objData->faceList[i])->vertex_index[0]);
-		temp_vec.push_back((objData->faceList[i])->vertex_index[1]);
-		temp_vec.push_back((objData->faceList[i])->vertex_index[2]);
-		object.indexDrawVec.push_back(temp_vec);
-	}
+  //Drawing uses the same vectors
 
   //Make 1D vector of indices for geometry
+  int indexCount = object.indCount;
   for(int i=0; i< indexCount; i++)
   {
     object.indexGeomVec.push_back((objData->faceList[i])->vertex_index[0]);
@@ -357,196 +531,250 @@ void setObject (MyObject &object, double number, char* filename){
   }
 
   //The object's center of mass must be at 0,0,0 relative to the rest of the object, that's why we scale and then shift by the calculated centerOfMass
-  //Make 1D vector of vertices for drawing
-  int vertCount =  object.vertCount;
-	for(int i=0; i< vertCount ; i++){
-		object.vertexDrawVec.push_back( objData->vertexList[i]->e[0]/SCALE - object.centerOfMass[0]);
-		object.vertexDrawVec.push_back( objData->vertexList[i]->e[1]/SCALE - object.centerOfMass[1]);
-		object.vertexDrawVec.push_back( objData->vertexList[i]->e[2]/SCALE - object.centerOfMass[2]);
-	}
-
   //Make 1D vector of vertices for geometry
+  int vertCount =  object.vertCount;
   for(int i=0; i< vertCount ; i++){
 		object.vertexGeomVec.push_back( objData->vertexList[i]->e[0]/SCALE - object.centerOfMass[0]);
 		object.vertexGeomVec.push_back( objData->vertexList[i]->e[1]/SCALE - object.centerOfMass[1]);
 		object.vertexGeomVec.push_back( objData->vertexList[i]->e[2]/SCALE - object.centerOfMass[2]);
 	}
+  object.indices = object.indexGeomVec.data();
+  object.vertices = object.vertexGeomVec.data();
+
+  //size of the object, used by the ANALYTIC check
+  object.radius = 0;
+  vector<Eigen::Vector3d> points(vertCount);
+  for(int i=0; i< vertCount ; i++){
+    const float *v = &object.vertices[3*i];
+    object.radius = std::max(object.radius, std::sqrt((double)(v[0]*v[0] + v[1]*v[1] + v[2]*v[2])));
+    points[i] = Eigen::Vector3d(v[0], v[1], v[2]);
+  }
+
+  //convex hull for the SUPPORT_SHORTCUT check. The hull of 512 extreme points is close enough and quick to build even for big scans
+  ConvexHull hull;
+  object.hullVertices.clear();
+  object.hullMeshVertices.clear();
+  object.hullMeshIndices.clear();
+  if (buildConvexHull(extremePoints(points, 512), hull)){
+    object.hullVertices = hull.vertices;
+    for (int i = 0; i < hull.vertices.size(); i++){
+      for (int k = 0; k < 3; k++) object.hullMeshVertices.push_back(hull.vertices[i][k]);
+    }
+    object.hullMeshIndices = hull.triangles;
+  }
+
+  //oriented bounding box along the principal axes of the vertices, for CASCADE
+  Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+  for (int i = 0; i < vertCount; i++) mean += points[i];
+  mean /= std::max(vertCount, 1);
+  Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+  for (int i = 0; i < vertCount; i++) covariance += (points[i] - mean) * (points[i] - mean).transpose();
+  Eigen::Matrix3d axes = Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d>(covariance).eigenvectors();
+  if (axes.determinant() < 0) axes.col(2) *= -1;  //keep it right handed so the triangles face outwards
+  Eigen::Vector3d lo = Eigen::Vector3d::Constant(1e300), hi = Eigen::Vector3d::Constant(-1e300);
+  for (int i = 0; i < vertCount; i++){
+    Eigen::Vector3d p = axes.transpose() * points[i];
+    lo = lo.cwiseMin(p);
+    hi = hi.cwiseMax(p);
+  }
+  object.boxVertices.clear();
+  for (int i = 0; i < 8; i++){  //corner i has bit 0 set for the high x side, bit 1 for y and bit 2 for z
+    Eigen::Vector3d corner((i&1) ? hi[0] : lo[0], (i&2) ? hi[1] : lo[1], (i&4) ? hi[2] : lo[2]);
+    corner = axes * corner;
+    for (int k = 0; k < 3; k++) object.boxVertices.push_back(corner[k]);
+  }
+  object.boxIndices = {0,2,1, 1,2,3,  4,5,6, 5,7,6,  0,1,4, 1,5,4,  2,6,3, 3,6,7,  0,4,2, 2,4,6,  1,3,5, 3,7,5};
+
+}
+
+
+/* true if filename is a model store rather than a .obj file */
+static bool isModelStore(const string &filename){
+  return filename.size() >= 8 && filename.compare(filename.size() - 8, 8, ".svstore") == 0;
+}
+
 
+/* Sets an object's data from a model store, like setObject() does from a .obj file. The trimesh isn't copied, the
+   object points into the store's read-only mapping. The model keeps the scale it was stored with */
+static bool storeObject(MyObject &object, const string &filename){
+  std::shared_ptr<ModelStore> store = ModelStore::shared(filename);
+  const StoredModel *stored = store ? store->find(object.model_ID) : 0;
+  if (!stored){
+    if (store) std::cout<<"***ERROR*** in setModels(). "<<filename<<" has no model called "<<object.model_ID<<endl;
+    return false;
+  }
+  const char *data = store->data();
+  object.store = store;
+  object.indexGeomVec.clear();
+  object.vertexGeomVec.clear();
+  object.indCount = stored->triCount;
+  object.vertCount = stored->vertCount;
+  object.indices = (const int*)(data + stored->indexOffset);
+  object.vertices = (const float*)(data + stored->vertexOffset);
+  object.centerOfMass = {(float)stored->centerOfMass[0], (float)stored->centerOfMass[1], (float)stored->centerOfMass[2]};
+  object.radius = stored->radius;
+
+  //the hull and the box are small, each world gets its own copy
+  const double *hull = (const double*)(data + stored->hullOffset);
+  const int *hullIndices = (const int*)(data + stored->hullIndexOffset);
+  object.hullVertices.clear();
+  object.hullMeshVertices.assign(hull, hull + 3*stored->hullCount);
+  for (int i = 0; i < stored->hullCount; i++){
+    object.hullVertices.push_back(Eigen::Vector3d(hull[3*i], hull[3*i+1], hull[3*i+2]));
+  }
+  object.hullMeshIndices.assign(hullIndices, hullIndices + 3*stored->hullTriCount);
+  const float *box = (const float*)(data + stored->boxOffset);
+  object.boxVertices.assign(box, box + 24);
+  object.boxIndices = {0,2,1, 1,2,3,  4,5,6, 5,7,6,  0,1,4, 1,5,4,  2,6,3, 3,6,7,  0,4,2, 2,4,6,  1,3,5, 3,7,5};
+  return true;
 }
 
 
 /* construct the object and put it into the world */
-void makeObject (MyObject &object){
-  int i,j,k;
-  dMass m;  //this is ODE's special "mass" object. It contains inertia info, actual weight and center of mass. Look at mass.h and mass.cpp for more info in ODE library
-
-  object.body = dBodyCreate (world);  //you must create a "body" AND a "geom" (geometry) to represent an model in ODE
-  dBodySetData (object.body,(void*)(size_t)i);
-
-  //build Trimesh geom
-  dTriMeshDataID new_tmdata = dGeomTriMeshDataCreate();  //set a trimesh ODE data type 
-  dGeomTriMeshDataBuildSingle(new_tmdata, object.vertexGeomVec.data(), 3 * sizeof(float),    //build the geometry of the trimesh
-	     object.vertCount, (int*)object.indexGeomVec.data(), object.indCount*3, 3 * sizeof(int));
-  object.geom[0] = dCreateTriMesh(space, new_tmdata, 0, 0, 0);  //create the trimesh using the ODE trimesh data that was just defined
-  dGeomSetData(object.geom[0], new_tmdata);  //officially set the data into the object's geom (geometry)
-  dMassSetTrimesh( &m, DENSITY, object.geom[0] );  //set the trimesh's mass
-  
+void makeObject (SimWorld &w, MyObject &object){
+  //the backend makes the body and its geometry from the trimesh
+  object.body = w.backend->createBody(object.vertices, object.vertCount, object.indices, object.indCount, DENSITY);
+
   //gets the absolute bounding box, you can print it. Nothing currently used the the AABB info, but could be helpful at some point
-  dReal aabb[6];
-  dGeomGetAABB (object.geom[0], aabb);
   if (PRINT_AABB){
+    double aabb[6] = {1e300, -1e300, 1e300, -1e300, 1e300, -1e300};
+    for (int i = 0; i < object.vertCount; i++){
+      for (int k = 0; k < 3; k++){
+        aabb[2*k]   = std::min(aabb[2*k],   (double)object.vertices[3*i+k]);
+        aabb[2*k+1] = std::max(aabb[2*k+1], (double)object.vertices[3*i+k]);
+      }
+    }
     printf("AABB: minX %.3f, maxX %.3f, minY %.3f, maxY %.3f, minZ %.3f, maxZ %.3f\n",aabb[0],aabb[1],aabb[2],aabb[3],aabb[4],aabb[5] );
     printf("\n");
   }
-
-  dGeomSetPosition(object.geom[0], m.c[0], m.c[1], m.c[2]);  //this is required because ODE's mass has to be at (0,0,0)
-  dMassTranslate(&m, -m.c[0], -m.c[1], -m.c[2]);  //object's center of mass must be at 0,0,0 relative to the rest of the object
-
-  //build Trimesh body and unite geom with body
-  for (k=0; k < GPB; k++){  //set body loop
-      if (object.geom[k]){
-          dGeomSetBody(object.geom[k],object.body); //unite body and geometry 
-      }
-  }
-  dBodySetMass(object.body,&m);  //set the body's mass
-
 }
 
 
 
 /* set the objects' 6DoF poses */
-void translateObject(MyObject &object, const dReal* center, const dMatrix3 R ){
+void translateObject(SimWorld &w, MyObject &object, const double* center, const double R[12] ){
       object.center[0] = center[0];  //set the object's initial x position (used when comparing initial vs final positions)
       object.center[1] = center[1];  //set the object's initial y position
       object.center[2] = center[2];  //set the object's initial z position
-      dBodySetPosition (object.body, center[0], center[1], center[2]);  //now we ACTUALLY set it's position in the simulation
-      dBodySetRotation (object.body, R);        //set it's rotation
-      dBodySetLinearVel(object.body, 0, 0, 0);  //set linear velocity to 0, else it would keep old lin. & ang. vel. from before we translated it
-      dBodySetAngularVel(object.body, 0, 0, 0); //set angular velocity to 0
+      w.backend->setPose(object.body, center, R);  //now we ACTUALLY set it's position (and rotation) in the simulation, this also zeroes its velocities
 }
 
 
-/* set previous transformation matrix for trimesh 
-   not entirely sure what this function's purpose is as it was directly from ODE trimesh demo */
-void setCurrentTransform(dGeomID geom){
-   const dReal* Pos = dGeomGetPosition(geom);  //get the object's current position
-   const dReal* Rot = dGeomGetRotation(geom);  //get the object's current rotation
-   const dReal Transform[16] =
-   {
-     Rot[0], Rot[4], Rot[8],  0,
-     Rot[1], Rot[5], Rot[9],  0,
-     Rot[2], Rot[6], Rot[10], 0,
-     Pos[0], Pos[1], Pos[2],  1
-   };
-   dGeomTriMeshSetLastTransform( geom, *(dMatrix4*)(&Transform) );
+/* Adaptive step schedule (ADAPTIVE = true). Called after collision detection and before stepping.
+   If a contact is deeper than ADAPT_DEPTH, or some body would travel further than ADAPT_DEPTH during the step, the scene is
+   "violent": the timestep is halved and the solver iterations doubled so the contacts are resolved accurately.
+   If everything is well below ADAPT_DEPTH the scene is "quiet": the timestep grows by 25% and the iterations drop by a few,
+   which is the common case for objects resting in place and is where the saved steps come from.
+   This also keeps real -9.8 gravity stable, since a fall into a contact shrinks the step before it can blow up. */
+static void adaptStep(SimWorld &w){
+  double maxSpeed = 0;  //fastest speed of any body, angular speed counts as well since trimeshes are around 1 unit in size
+  for (int i=0; i<w.stepBodies.size(); i++){
+    double v[3], a[3];
+    w.backend->getVelocity(w.stepBodies[i], v, a);
+    double speed = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]) + std::sqrt(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]);
+    maxSpeed = std::max(maxSpeed, speed);
+  }
+  if (w.stepMaxDepth > ADAPT_DEPTH || maxSpeed*w.stepSize > ADAPT_DEPTH){
+    w.stepSize = std::max(w.stepSize*0.5, TIMESTEP_MIN);
+    w.stepIterations = std::min(w.stepIterations*2, ITERATIONS_MAX);
+  } else if (w.stepMaxDepth < ADAPT_DEPTH*0.5 && maxSpeed*w.stepSize < ADAPT_DEPTH*0.25){
+    w.stepSize = std::min(w.stepSize*1.25, TIMESTEP_MAX);
+    w.stepIterations = std::max(w.stepIterations-4, ITERATIONS_MIN);
+  }
 }
 
 
-
-
 /* simulation loop */
-static void simLoop (int pause)
+static void simLoop (SimWorld &w, int pause)
 {
   //if DRAW = true, this is used to terminate the simloop from dsSimulationLoop()
-  if (counter == dsSTEP){
-      dsStop();
+  if (DRAW){
+    if (ADAPTIVE ? w.stats.simulatedTime >= w.dsTIME : w.counter == w.dsSTEP){
+        dsStop();
+    }
+    w.counter ++;
   }
-  counter ++;
 
 
-  //define the space and collide function
-  dSpaceCollide (space,0,&nearCallback);
-
-//not quite sure what this code block or what setCurrentTransform() does, but it was from ODE trimesh demo
-#if 1
-  if (!pause)
-  {
-    for (int i=0; i<num; i++)
-      for (int j=0; j < GPB; j++)
-        if (obj[i].geom[j])
-          if (dGeomGetClass(obj[i].geom[j]) == dTriMeshClass)
-            setCurrentTransform(obj[i].geom[j]);
+  //collision detection, the contacts are used by the next step
+  const vector<BackendContact> &contacts = w.backend->generateContacts();
+  w.stepMaxDepth = 0;
+  for (int i = 0; i < contacts.size(); i++){
+    w.stepMaxDepth = std::max(w.stepMaxDepth, contacts[i].depth);
+  }
+  if (!w.reportBodies.empty() && w.reportSteps++ <= STEP1){  //support graph from the first check, while the scene is still close to its starting poses
+    recordSupport(w, contacts);
+  }
+  if (DRAW && show_contacts){
+    dMatrix3 RI;
+    dRSetIdentity (RI);
+    const dReal ss[3] = {0.02,0.02,0.02};
+    for (int i = 0; i < contacts.size(); i++){
+      dsDrawBox (contacts[i].pos,RI,ss);
+    }
+  }
+  if (ADAPTIVE){
+    adaptStep(w);
   }
-#endif
-
-  if (!pause) dWorldQuickStep (world,TIMESTEP); //<- this is a big factor in accuracy and how long simulation takes
 
-  //not 100% what dSpaceGetNumGeoms() does... It was in ODE trimesh demo.
-  for (int j = 0; j < dSpaceGetNumGeoms(space); j++){
-	  dSpaceGetGeom(space, j);
+  if (!pause){
+    w.backend->step(w.stepSize, w.stepIterations); //<- this is a big factor in accuracy and how long simulation takes
+
+    //keep track of what this step cost
+    w.stats.steps++;
+    w.stats.simulatedTime += w.stepSize;
+    w.stats.totalIterations += w.stepIterations;
+    w.stats.minTimestep = std::min(w.stats.minTimestep, w.stepSize);
+    w.stats.maxTimestep = std::max(w.stats.maxTimestep, w.stepSize);
+    w.stats.minIterations = std::min(w.stats.minIterations, w.stepIterations);
+    w.stats.maxIterations = std::max(w.stats.maxIterations, w.stepIterations);
   }
-  // remove all contact joints
-  dJointGroupEmpty (contactgroup);
 
-  //set the color and the texture for the objects when drawing them
+  //this is where drawstuff library actually draws the trimesh
   if(DRAW){
+    //set the color and the texture for the objects when drawing them
     dsSetColor (1,1,0);
     dsSetTexture (DS_WOOD);
-  }
-
-  //updates the position and rotation with every step through the simulation
-  for (int i=0; i<num; i++) {
-    for (int j=0; j < GPB; j++) {
-      if (obj[i].geom[j]) {
-        if (dGeomGetClass(obj[i].geom[j]) == dTriMeshClass) {
-          const dReal* Pos = dGeomGetPosition(obj[i].geom[j]);  //get and set the new position
-          const dReal* Rot = dGeomGetRotation(obj[i].geom[j]);  //get and set the new rotation
-
-        //this is where drawstuff library actually draws the trimesh
-        if (DRAW) {
-            for (int ii = 0; ii < obj[i].indCount; ii++) {
-                const dReal v[9] = { // explicit conversion from float to dReal
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][0] * 3 + 0],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][0] * 3 + 1],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][0] * 3 + 2],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][1] * 3 + 0],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][1] * 3 + 1],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][1] * 3 + 2],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][2] * 3 + 0],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][2] * 3 + 1],
-                  obj[i].vertexDrawVec[obj[i].indexDrawVec[ii][2] * 3 + 2]
-                };
-                dsDrawTriangle(Pos, Rot, &v[0], &v[3], &v[6], 1);  //a trimesh is made up of triangles so triangles are drawn
-
-              }
-        }
-
-      //not quite sure what the following code from here until the end of this function does but it was from ODE's trimesh demos
-      //the following comments are from the demo as well
-
-      // tell the tri-tri collider the current transform of the trimesh --
-      // this is fairly important for good results.
-		  // Fill in the (4x4) matrix.
-		  dReal* p_matrix = obj[i].matrix_dblbuff + ( obj[i].last_matrix_index * 16 );
 
-		  p_matrix[ 0 ] = Rot[ 0 ];	p_matrix[ 1 ] = Rot[ 1 ];	p_matrix[ 2 ] = Rot[ 2 ];	p_matrix[ 3 ] = 0;
-		  p_matrix[ 4 ] = Rot[ 4 ];	p_matrix[ 5 ] = Rot[ 5 ];	p_matrix[ 6 ] = Rot[ 6 ];	p_matrix[ 7 ] = 0;
-		  p_matrix[ 8 ] = Rot[ 8 ];	p_matrix[ 9 ] = Rot[ 9 ];	p_matrix[10 ] = Rot[10 ];	p_matrix[11 ] = 0;
-		  p_matrix[12 ] = Pos[ 0 ];	p_matrix[13 ] = Pos[ 1 ];	p_matrix[14 ] = Pos[ 2 ];	p_matrix[15 ] = 1;
-
-		  // Flip to other matrix.
-		  obj[i].last_matrix_index = !obj[i].last_matrix_index;
-
-		  dGeomTriMeshSetLastTransform( obj[i].geom[j],
-			  *(dMatrix4*)( obj[i].matrix_dblbuff + obj[i].last_matrix_index * 16 ) );
-
-        }
+    for (int i=0; i<w.num; i++) {
+      double Pos[3], Rot[12];
+      w.backend->getPose(w.obj[i].body, Pos, Rot);  //get the new position and rotation
+      for (int ii = 0; ii < w.obj[i].indCount; ii++) {
+          const dReal v[9] = { // explicit conversion from float to dReal
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 0] * 3 + 0],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 0] * 3 + 1],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 0] * 3 + 2],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 1] * 3 + 0],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 1] * 3 + 1],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 1] * 3 + 2],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 2] * 3 + 0],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 2] * 3 + 1],
+            w.obj[i].vertices[w.obj[i].indices[3*ii + 2] * 3 + 2]
+          };
+          dsDrawTriangle(Pos, Rot, &v[0], &v[3], &v[6], 1);  //a trimesh is made up of triangles so triangles are drawn
       }
     }
   }
 }
 
 
+/* the step function given to drawstuff */
+static void drawstuffStep (int pause)
+{
+  simLoop(*drawWorld, pause);
+}
+
 
 
 /* special simulation loop needed when drawing a scene (ultimately still uses simloop() though) */
-void drawstuffsimLoop(){
+void drawstuffsimLoop(SimWorld &w){
   int argc=NULL;           //just an argument that dsSimulationLoop must take. not used.
   char **argv=NULL;        //just an argument that dsSimulationLoop must take. not used.
   dsFunctions fn;          //defines callback functions used in dsSimulationLoop
   fn.version = DS_VERSION; //gets version number 
   fn.start = &start;       //start() is a function defined above which set the viewpoint
-  fn.step = &simLoop;      //simloop() is the simulaiton routine used in dsSimulationLoop
+  fn.step = &drawstuffStep;//simloop() is the simulaiton routine used in dsSimulationLoop
+  drawWorld = &w;
   fn.command = NULL;       //if you want to have keyboard input. not used.
   fn.stop = NULL;          //if you want to customize the stop function. not used.
   fn.path_to_textures = DRAWSTUFF_TEXTURE_PATH;  //Remember to include text path in texturepath.h
@@ -556,47 +784,161 @@ void drawstuffsimLoop(){
 
 
 /* sets all the models' data */
-void SceneValidator::setModels(std::vector<string> modelnames, std::vector<string> filenames){
+std::vector<int> SceneValidator::setModels(std::vector<string> modelnames, std::vector<string> filenames){
+   stopAsync(false);  //the workers have to load the new models too
+   std::vector<int> handles;
 
    //set the data in an obj array
    if( modelnames.size() != filenames.size()){
           std::cout<<"***ERROR*** in setModels(std::vector<string> modelnames, std::vector<string> filenames). The problem is that modelnames is not the same size as filenames"<<endl;
    } else{
-      num = filenames.size();  //number of models in scene
-      for (int i =0; i < num; i++){
-          obj[i].model_ID=modelnames[i];  //set model ID to the corresponding model name
-          char *charfilenames = new char[filenames[i].length() + 1]; //convert to string
-          std::strcpy(charfilenames, filenames[i].c_str());  //convert to string
-          setObject(obj[i], scaling[i], charfilenames );   //set object's data
-          makeObject(obj[i]);  //create an object that can be used in simulation
+      //the old models' bodies, their copies and coarse bodies are destroyed before their meshes are replaced
+      for (int i = 0; i < sim->numModels; i++){
+        if (sim->obj[i].body >= 0) sim->backend->destroyBody(sim->obj[i].body);
+      }
+      for (auto &copies : sim->copyBodies){
+        for (int k = 0; k < copies.second.size(); k++){
+          sim->backend->destroyBody(copies.second[k]);
+        }
+      }
+      for (auto &tiers : sim->tierBodies){
+        if (tiers.second.empty()) continue;
+        sim->backend->destroyBody(tiers.second[0]);
+        if (tiers.second[1] != tiers.second[0]) sim->backend->destroyBody(tiers.second[1]);  //a flat model's hull body is its box body
+      }
+      sim->m.clear();
+      sim->num = filenames.size();  //number of models in scene
+      sim->numModels = sim->num;
+      sim->copyBodies.clear();
+      sim->tierBodies.clear();
+      sim->cache.clear();
+      sim->committed.clear();
+      sim->modelNames = modelnames;
+      sim->modelFiles = filenames;
+      for (int i =0; i < sim->num; i++){
+          sim->obj[i].model_ID=modelnames[i];  //set model ID to the corresponding model name
+          if (isModelStore(filenames[i])){
+            if (!storeObject(sim->obj[i], filenames[i])){  //left empty, it won't collide with anything
+              sim->obj[i] = MyObject();
+              sim->obj[i].model_ID = modelnames[i];
+            }
+          } else {
+            char *charfilenames = new char[filenames[i].length() + 1]; //convert to string
+            std::strcpy(charfilenames, filenames[i].c_str());  //convert to string
+            setObject(sim->obj[i], sim->scaling[i], charfilenames );   //set object's data
+          }
+          makeObject(*sim, sim->obj[i]);  //create an object that can be used in simulation
       }
    }
    //make hashmap between modelnames and their data
-   for (int i =0; i < num; i++){    
-      m[modelnames[i]]=obj[i];
+   for (int i =0; i < sim->num; i++){    
+      sim->m[modelnames[i]]=sim->obj[i];
+      handles.push_back(i);  //the handle is the model's index in obj[]
    }
+   sim->handleMark.assign(sim->numModels, 0);
+   sim->stepBodies.reserve(NUM);
+   return handles;
 }
 
 
 
-/*checks if scene is stable after certain number of steps */
-static bool isStableStill(std::vector<string> modelnames, int step){
+/* writes the loaded models to a model store */
+bool SceneValidator::saveModelStore(std::string filename){
+  if (!isModelStore(filename)){
+    std::cout<<"***ERROR*** in saveModelStore(). "<<filename<<" should end in .svstore, or setModels() won't know it's a model store"<<endl;
+    return false;
+  }
+  vector<ModelArrays> models(sim->numModels);
+  for (int i = 0; i < sim->numModels; i++){
+    MyObject &object = sim->obj[i];
+    ModelArrays &a = models[i];
+    a.name = object.model_ID;
+    const StoredModel *stored = object.store ? object.store->find(object.model_ID) : 0;
+    a.scale = stored ? stored->scale : sim->scaling[i];
+    for (int k = 0; k < 3; k++) a.centerOfMass[k] = object.centerOfMass.size() == 3 ? object.centerOfMass[k] : 0;
+    a.radius = object.radius;
+    a.vertices = object.vertices;
+    a.vertCount = object.vertCount;
+    a.indices = object.indices;
+    a.triCount = object.indCount;
+    for (int k = 0; k < object.hullVertices.size(); k++){
+      for (int j = 0; j < 3; j++) a.hull.push_back(object.hullVertices[k][j]);
+    }
+    a.hullIndices = object.hullMeshIndices;
+    a.box = object.boxVertices.size() == 24 ? object.boxVertices.data() : 0;
+    if (!a.box || (!a.vertices && a.vertCount > 0)){
+      std::cout<<"***ERROR*** in saveModelStore(). "<<a.name<<" wasn't loaded"<<endl;
+      return false;
+    }
+  }
+  return ModelStore::write(filename, models);
+}
+
+
+/* True when the simulation has to stop early: the async scene was cancelled or the call's budget (see isValidScene() with
+   a SceneBudget) ran out. Once it is true it stays true until the next scene starts */
+static bool stopped(SimWorld &w){
+    if (!w.stoppedEarly){
+      w.stoppedEarly = (w.cancel && w.cancel->load())
+                    || (w.stepBudget > 0 && w.stats.steps >= w.stepBudget)
+                    || (w.hasDeadline && chrono::steady_clock::now() >= w.deadline);
+    }
+    return w.stoppedEarly;
+}
+
+
+/* runs the simulation for one check's worth of steps */
+static void runSteps(SimWorld &w, int step){
+    //when ADAPTIVE the check lasts as much simulated time as step fixed steps of TIMESTEP would, however many steps that takes
+    double endTime = w.stats.simulatedTime + (step+1)*TIMESTEP;
     if (DRAW){
-      counter=0;
-      dsSTEP=step;
-      drawstuffsimLoop();
+      w.counter=0;
+      w.dsSTEP=step;
+      w.dsTIME=endTime;
+      drawstuffsimLoop(w);
+    } else if (ADAPTIVE){
+      while (w.stats.simulatedTime < endTime && !stopped(w)){
+        simLoop(w, 0);
+      }
     } else {
-      for(int i = 0; i <= step; i++) {
-        simLoop(0);
+      for(int i = 0; i <= step && !stopped(w); i++) {
+        simLoop(w, 0);
        }
     }
-    return isValid(modelnames);
 }
 
 
+/*checks if scene is stable after certain number of steps */
+static bool isStableStill(SimWorld &w, std::vector<string> modelnames, int step){
+    runSteps(w, step);
+    if (w.stoppedEarly){  //cancelled, or out of budget and the caller gets "undecided"
+      return false;
+    }
+    return isValid(w, modelnames);
+}
+
+
+
+/* Parameters which only change what's printed or drawn, how the work is spread over threads, or findPlacement() and
+   settleScene(). Setting them keeps the cached verdicts */
+static bool keepsVerdicts(const std::string &param_name){
+      static const char *names[] = {"DRAW", "PRINT_START_POS", "PRINT_END_POS", "PRINT_DELTA_POS", "PRINT_CHKR_RSLT",
+                                    "PRINT_AABB", "PRINT_COM", "COMPONENT_FAIL_FAST", "ASYNC_THREADS", "ASYNC_QUEUE",
+                                    "COLLIDE_THREADS", "PLACEMENT_BISECT", "PLACEMENT_TOLERANCE", "SETTLE_STEPS", "SETTLE_SPEED"};
+      for (int i = 0; i < sizeof(names)/sizeof(names[0]); i++){
+        if (param_name.compare(names[i]) == 0){
+          return true;
+        }
+      }
+      return false;
+}
+
 
 /* allows user to set certain parameters */
 bool  SceneValidator::setParams(std::string param_name, double param_value){
+      if (!keepsVerdicts(param_name)){
+        paramGeneration++;  //cached verdicts may not hold any more
+      }
       if( param_name.compare("STEP1") == 0 ){
         STEP1 = param_value;
         return true;
@@ -678,6 +1020,87 @@ bool  SceneValidator::setParams(std::string param_name, double param_value){
       } else if( param_name.compare("PRINT_COM") == 0 ){
         PRINT_COM = param_value;
         return true;
+      } else if( param_name.compare("ANALYTIC") == 0 ){
+        ANALYTIC = param_value;
+        return true;
+      } else if( param_name.compare("ANALYTIC_ACCEPT") == 0 ){
+        ANALYTIC_ACCEPT = param_value;
+        return true;
+      } else if( param_name.compare("ANALYTIC_REJECT") == 0 ){
+        ANALYTIC_REJECT = param_value;
+        return true;
+      } else if( param_name.compare("CASCADE") == 0 ){
+        CASCADE = param_value;
+        return true;
+      } else if( param_name.compare("CASCADE_MARGIN") == 0 ){
+        CASCADE_MARGIN = param_value;
+        return true;
+      } else if( param_name.compare("COMPONENTS") == 0 ){
+        COMPONENTS = param_value;
+        return true;
+      } else if( param_name.compare("COMPONENT_FAIL_FAST") == 0 ){
+        COMPONENT_FAIL_FAST = param_value;
+        return true;
+      } else if( param_name.compare("CACHE_SIZE") == 0 ){
+        CACHE_SIZE = std::max(0, (int)param_value);
+        return true;
+      } else if( param_name.compare("CACHE_GRID") == 0 ){
+        CACHE_GRID = param_value;
+        return true;
+      } else if( param_name.compare("CACHE_ANGLE") == 0 ){
+        CACHE_ANGLE = param_value;
+        return true;
+      } else if( param_name.compare("ASYNC_THREADS") == 0 ){
+        ASYNC_THREADS = std::max(1, (int)param_value);
+        return true;
+      } else if( param_name.compare("ASYNC_QUEUE") == 0 ){
+        ASYNC_QUEUE = std::max(1, (int)param_value);
+        return true;
+      } else if( param_name.compare("PRECLASSIFIER") == 0 ){
+        PRECLASSIFIER = param_value;
+        return true;
+      } else if( param_name.compare("ADAPTIVE") == 0 ){
+        ADAPTIVE = param_value;
+        return true;
+      } else if( param_name.compare("ADAPT_DEPTH") == 0 ){
+        ADAPT_DEPTH = param_value;
+        return true;
+      } else if( param_name.compare("TIMESTEP_MIN") == 0 ){
+        TIMESTEP_MIN = param_value;
+        return true;
+      } else if( param_name.compare("TIMESTEP_MAX") == 0 ){
+        TIMESTEP_MAX = param_value;
+        return true;
+      } else if( param_name.compare("ITERATIONS") == 0 ){
+        ITERATIONS = param_value;
+        return true;
+      } else if( param_name.compare("ITERATIONS_MIN") == 0 ){
+        ITERATIONS_MIN = param_value;
+        return true;
+      } else if( param_name.compare("ITERATIONS_MAX") == 0 ){
+        ITERATIONS_MAX = param_value;
+        return true;
+      } else if( param_name.compare("MAX_CORRECTING_VEL") == 0 ){
+        MAX_CORRECTING_VEL = param_value;
+        return true;
+      } else if( param_name.compare("COLLIDE_THREADS") == 0 ){
+        COLLIDE_THREADS = std::max(1, (int)param_value);
+        return true;
+      } else if( param_name.compare("HEIGHTFIELD_THICKNESS") == 0 ){
+        HEIGHTFIELD_THICKNESS = param_value;
+        return true;
+      } else if( param_name.compare("PLACEMENT_BISECT") == 0 ){
+        PLACEMENT_BISECT = param_value;
+        return true;
+      } else if( param_name.compare("PLACEMENT_TOLERANCE") == 0 ){
+        PLACEMENT_TOLERANCE = param_value;
+        return true;
+      } else if( param_name.compare("SETTLE_STEPS") == 0 ){
+        SETTLE_STEPS = param_value;
+        return true;
+      } else if( param_name.compare("SETTLE_SPEED") == 0 ){
+        SETTLE_SPEED = param_value;
+        return true;
       } else {
         cout<<"Invalid parameter name: "<<param_name;
         return false;
@@ -686,37 +1109,201 @@ bool  SceneValidator::setParams(std::string param_name, double param_value){
 
 /* allows user to set the scale of a specific object */
 bool  SceneValidator::setScale(int thisObject, double scaleFactor){
-      scaling[thisObject] = scaleFactor;
+      stopAsync(false);
+      sim->scaling[thisObject] = scaleFactor;
 }
 
 
 
-/* checks if a given scene is in static equilibrium or not */
-bool SceneValidator::isValidScene(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses){
-    //set all the Objects's positions
-    num = modelnames.size();
-    for (int i =0; i < num; i++){
-       auto mappedObject= m.find(modelnames[i]);   //get model from hashmap
-       Eigen::Affine3d a = model_poses[i];
-       const dMatrix3 R = {                        //convert affine info to a 3x3 rotation matrix and a x,y,z position array
-         a(0,0), a(0,1), a(0,2),
-         a(1,0), a(1,1), a(1,2),
-         a(2,0), a(2,1), a(2,2)    };
-       const dReal center[3] = {a.translation()[0],a.translation()[1], a.translation()[2]};
-       translateObject(mappedObject->second, center, R);  //get the model name's MyObject info and feed it the position and rotation
+/* the current parameters in the form the backend takes them */
+static BackendSettings backendSettings(){
+  BackendSettings settings;
+  settings.friction = FRICTION_mu;
+  settings.friction2 = FRICTION_mu2;
+  settings.bounce = BOUNCE;
+  settings.bounceVel = BOUNCE_vel;
+  settings.softCFM = SOFT_CFM;
+  settings.maxContacts = MAX_CONTACTS;
+  settings.maxCorrectingVel = MAX_CORRECTING_VEL;
+  settings.collideThreads = COLLIDE_THREADS;
+  return settings;
+}
+
+
+/* converts an Affine3d to a x,y,z position array and a 3x3 rotation matrix (in ODE's 3x4 layout) */
+static void poseToArrays(const Eigen::Affine3d &a, double center[3], double R[12]){
+    const double rotation[12] = {
+      a(0,0), a(0,1), a(0,2), 0,
+      a(1,0), a(1,1), a(1,2), 0,
+      a(2,0), a(2,1), a(2,2), 0    };
+    std::copy(rotation, rotation+12, R);
+    for (int k = 0; k < 3; k++){
+      center[k] = a.translation()[k];
+    }
+}
+
+
+/* the inverse of poseToArrays() */
+static Eigen::Affine3d arraysToPose(const double center[3], const double R[12]){
+    Eigen::Matrix3d r;
+    r << R[0], R[1], R[2],
+         R[4], R[5], R[6],
+         R[8], R[9], R[10];
+    Eigen::Affine3d a = Eigen::Affine3d::Identity();
+    a.linear() = r;
+    a.translation() = Eigen::Vector3d(center[0], center[1], center[2]);
+    return a;
+}
+
+
+/* Simulation free check (ANALYTIC = true). Finds the contacts at the starting pose and asks if contact forces inside
+   the friction cones (FRICTION_mu) can hold every body still. Returns 1 for valid, 0 for invalid and -1 when it can't tell,
+   e.g. a body that doesn't touch anything yet might only drop a little and settle, so the scene has to be simulated */
+static int analyticCheck(SimWorld &w, std::vector<string> modelnames){
+    const vector<BackendContact> &contacts = w.backend->generateContacts();
+    vector<EquilibriumBody> bodies(modelnames.size());
+    vector<bool> touching(modelnames.size(), false);
+    for (int i = 0; i < modelnames.size(); i++){
+      MyObject &object = w.m.find(modelnames[i])->second;
+      double R[12];
+      bodies[i].handle = object.body;
+      bodies[i].mass = w.backend->getMass(object.body);
+      bodies[i].radius = std::max(object.radius, 1e-6);
+      w.backend->getPose(object.body, bodies[i].com, R);
+      for (int c = 0; c < contacts.size(); c++){
+        if (contacts[c].body1 == object.body || contacts[c].body2 == object.body) touching[i] = true;
+      }
+    }
+    vector<double> residuals = equilibriumResiduals(contacts, bodies, w.gravity, FRICTION_mu);
+    if (!w.reportBodies.empty()){
+      recordSupport(w, contacts);
+    }
+
+    int verdict = 1;
+    for (int i = 0; i < modelnames.size(); i++){
+      if (PRINT_CHKR_RSLT){
+        cout<<modelnames[i]<<" unbalanced: "<<residuals[i]<<(touching[i] ? "" : " (not touching anything)")<<endl;
+      }
+      if (touching[i] && residuals[i] > ANALYTIC_REJECT){
+        noteFailure(w, modelnames[i]);
+        return 0;
+      }
+      if (!touching[i] || residuals[i] > ANALYTIC_ACCEPT){
+        verdict = -1;
+      }
+    }
+    return verdict;
+}
+
+
+/* How far the center of mass of an object at pose, dropped along gravity onto the ground plane, is inside the polygon of
+   the hull corners within SUPPORT_TOLERANCE of its lowest corner (negative outside). lowest gets the height of the lowest
+   hull corner above the plane. Returns -1e300 if there is no hull, gravity doesn't push into the plane or the corners
+   don't enclose an area */
+static double supportMargin(SimWorld &w, MyObject &object, const Eigen::Affine3d &pose, double &lowest){
+    Eigen::Vector3d normal(w.plane[0], w.plane[1], w.plane[2]);
+    Eigen::Vector3d g(w.gravity[0], w.gravity[1], w.gravity[2]);
+    lowest = 1e300;
+    if (object.hullVertices.empty() || normal.dot(g) >= 0){
+      return -1e300;
+    }
+
+    //height of every hull corner above the plane
+    vector<Eigen::Vector3d> corners(object.hullVertices.size());
+    vector<double> heights(corners.size());
+    for (int i = 0; i < corners.size(); i++){
+      corners[i] = pose * object.hullVertices[i];
+      heights[i] = normal.dot(corners[i]) - w.plane[3];
+      lowest = std::min(lowest, heights[i]);
+    }
+
+    //support polygon in the plane's own 2D coordinates
+    Eigen::Vector3d u = normal.unitOrthogonal();
+    Eigen::Vector3d v = normal.cross(u);
+    vector<double> polygon;
+    for (int i = 0; i < corners.size(); i++){
+      if (heights[i] < lowest + SUPPORT_TOLERANCE){
+        polygon.push_back(u.dot(corners[i]));
+        polygon.push_back(v.dot(corners[i]));
+      }
+    }
+    Eigen::Vector3d com = pose.translation();
+    Eigen::Vector3d dropped = com - g * (normal.dot(com) - w.plane[3]) / normal.dot(g);
+    return polygonMargin(polygon, u.dot(dropped), v.dot(dropped));
+}
+
+
+/* Closed form check for an object which only touches the ground plane (SUPPORT_SHORTCUT = true). It stands still if its
+   center of mass, dropped along gravity onto the plane, is inside the polygon of the hull corners resting on the plane and
+   the plane isn't too steep for FRICTION_mu. Returns 1 for valid, 0 for invalid and -1 when it has to be simulated */
+static int supportCheck(SimWorld &w, MyObject &object, const Eigen::Affine3d &pose){
+    Eigen::Vector3d normal(w.plane[0], w.plane[1], w.plane[2]);
+    Eigen::Vector3d g(w.gravity[0], w.gravity[1], w.gravity[2]);
+    double down = -normal.dot(g);  //part of gravity pushing into the plane
+    if (object.hullVertices.empty() || down <= 0){
+      return -1;
+    }
+    double lowest;
+    double margin = supportMargin(w, object, pose, lowest);
+    if (std::abs(lowest) > SUPPORT_TOLERANCE){  //floating or sunk into the plane, the simulation has to sort it out
+      return -1;
+    }
+
+    //slides if the slope is steeper than the friction allows
+    if ((g + down*normal).norm() > FRICTION_mu * down){
+      return 0;
+    }
+    if (margin < -1e299){  //resting on an edge or a point (e.g. a round bottom), can't tell without simulating
+      return -1;
+    }
+    if (margin > SUPPORT_TOLERANCE){
+      return 1;
+    }
+    if (margin < -SUPPORT_TOLERANCE){
+      return 0;
+    }
+    return -1;
+}
+
+
+/* the bodies the named objects are simulated with right now become the ones adaptStep() watches */
+static void watchBodies(SimWorld &w, const std::vector<string> &modelnames){
+    w.stepBodies.clear();
+    for (int i = 0; i < modelnames.size(); i++){
+      w.stepBodies.push_back(w.m.find(modelnames[i])->second.body);
+    }
+}
+
+
+/* the four checks (and the ANALYTIC check before them) on the objects which have to be simulated. Without analytic the
+   objects are always simulated, so they end up where they settled */
+static bool checkScene(SimWorld &w, std::vector<string> modelnames, bool analytic = true){
+    w.num = modelnames.size();
+    watchBodies(w, modelnames);
+    if (w.num == 0){
+      return true;
+    }
+
+    //try to decide without simulating
+    if (ANALYTIC && analytic && !DRAW){
+      int verdict = analyticCheck(w, modelnames);
+      if (verdict >= 0){
+        w.stats.analytic = true;
+        return verdict == 1;
+      }
     }
 
     //complete series of checks to see if scene is still stable or not
-    if (!isStableStill(modelnames, STEP1)){   //check #1
+    if (!isStableStill(w, modelnames, STEP1)){   //check #1
          return false;
     } else
-    if (!isStableStill(modelnames, STEP2)){   //check #2
+    if (!isStableStill(w, modelnames, STEP2)){   //check #2
          return false;
     } else
-    if (!isStableStill(modelnames, STEP3)){   //check #3
+    if (!isStableStill(w, modelnames, STEP3)){   //check #3
          return false;
     } else
-    if (!isStableStill(modelnames, STEP4)){   //check #4
+    if (!isStableStill(w, modelnames, STEP4)){   //check #4
          return false;
     }
     else{
@@ -724,61 +1311,1800 @@ bool SceneValidator::isValidScene(std::vector<string> modelnames, std::vector<Ei
     }
 }
 
-/* custom constructor to construct a SceneValidator object */
-SceneValidator::SceneValidator(double GRAVITYx, double GRAVITYy, double GRAVITYz, double PLANEa, double PLANEb, double PLANEc, double PLANEd, double DEFAULT_SCALE){
-  //initialize ODE and the simulation enviornment
-  dInitODE2(0);
-  world = dWorldCreate();
-  space = dSimpleSpaceCreate(0);
-  contactgroup = dJointGroupCreate (0);
-  dWorldSetGravity (world,GRAVITYx,GRAVITYy,GRAVITYz);
-  dWorldSetCFM (world,1e-5);
-  dCreatePlane (space,PLANEa,PLANEb,PLANEc,PLANEd);
-  //initialize ODE's threading functions
-  dAllocateODEDataForThread(dAllocateMaskAll);
-  threading = dThreadingAllocateMultiThreadedImplementation();
-  pool = dThreadingAllocateThreadPool(4, 0, dAllocateFlagBasicData, NULL);
-  dThreadingThreadPoolServeMultiThreadedImplementation(pool, threading);
-  dWorldSetStepThreadingImplementation(world, dThreadingImplementationGetFunctions(threading), threading);
-  //scale the ALL objects to DEFAULT_SCALE
-  for (int i =0; i < NUM; i++){
-        scaling[i] = DEFAULT_SCALE;
-  }
+
+/* how far the objects which moved the most moved, measured like inStaticEquilibrium(). worstObject gets its index */
+static double maxDisplacement(SimWorld &w, std::vector<string> modelnames, int *worstObject = 0){
+    double worst = 0;
+    for (int i = 0; i < modelnames.size(); i++){
+      MyObject &object = w.m.find(modelnames[i])->second;
+      double pos[3], R[12];
+      w.backend->getPose(object.body, pos, R);
+      for (int k = 0; k < 3; k++){
+        if (std::abs(pos[k] - object.center[k]) > worst){
+          worst = std::abs(pos[k] - object.center[k]);
+          if (worstObject) *worstObject = i;
+        }
+      }
+    }
+    return worst;
 }
 
 
-/* default constructor to construct a SceneValidator object */
-SceneValidator::SceneValidator(){
-  //initialize ODE and the simulation enviornment
-  dInitODE2(0);
-  world = dWorldCreate();
-  space = dSimpleSpaceCreate(0);
-  contactgroup = dJointGroupCreate (0);
-  dWorldSetGravity (world,GRAVITYx,GRAVITYy,GRAVITYz);
-  dWorldSetCFM (world,1e-5);
-  dCreatePlane (space,PLANEa,PLANEb,PLANEc,PLANEd);
-  //initialize ODE's threading functions
-  dAllocateODEDataForThread(dAllocateMaskAll);
-  threading = dThreadingAllocateMultiThreadedImplementation();
-  pool = dThreadingAllocateThreadPool(4, 0, dAllocateFlagBasicData, NULL);
-  dThreadingThreadPoolServeMultiThreadedImplementation(pool, threading);
-  dWorldSetStepThreadingImplementation(world, dThreadingImplementationGetFunctions(threading), threading);
-  //scale the ALL objects to DEFAULT_SCALE
-  for (int i =0; i < NUM; i++){
-        scaling[i] = DEFAULT_SCALE;
-  }
+/* the coarse body of a model for a CASCADE tier (0 box, 1 hull), made the first time it's needed */
+static int tierBody(SimWorld &w, const string &name, int tier){
+    vector<int> &tiers = w.tierBodies[name];
+    if (tiers.empty()){
+      for (int i = 0; i < w.numModels; i++){  //the backend references the mesh arrays, so use the ones in obj[]
+        MyObject &object = w.obj[i];
+        if (object.model_ID == name){
+          tiers.push_back(w.backend->createBody(object.boxVertices.data(), 8, object.boxIndices.data(), 12, DENSITY));
+          if (object.hullMeshIndices.empty()){  //no hull (flat model), the box has to do
+            tiers.push_back(tiers[0]);
+          } else {
+            tiers.push_back(w.backend->createBody(object.hullMeshVertices.data(), object.hullMeshVertices.size()/3,
+                                                  object.hullMeshIndices.data(), object.hullMeshIndices.size()/3, DENSITY));
+          }
+          w.backend->setEnabled(tiers[0], false);
+          w.backend->setEnabled(tiers[1], false);
+          break;
+        }
+      }
+    }
+    return tiers[tier];
 }
 
-/* default destructor to destruct a SceneValidator object */
-SceneValidator::~SceneValidator(){
-  //shut down threading
-  dThreadingImplementationShutdownProcessing(threading);
-  dThreadingFreeThreadPool(pool);
-  dWorldSetStepThreadingImplementation(world, NULL, NULL);
-  dThreadingFreeImplementation(threading);
-  //shut down simulation enviornment
-  dJointGroupDestroy (contactgroup);
-  dSpaceDestroy (space);
-  dWorldDestroy (world);
-  dCloseODE();
-}
\ No newline at end of file
+
+/* Coarse to fine (CASCADE = true). The scene is simulated with every model replaced by its oriented bounding box, then by
+   its convex hull, and only if neither gives a clear answer with the full trimesh. A coarse tier decides the scene when
+   the objects stay well below THRESHOLD or one goes well past it, CASCADE_MARGIN being the "well" */
+static bool cascadeScene(SimWorld &w, std::vector<string> modelnames){
+    int steps[4] = {STEP1, STEP2, STEP3, STEP4};
+    for (int tier = 0; tier < 2; tier++){
+      //swap in the coarse bodies at the same poses
+      vector<int> fullBodies(modelnames.size());
+      for (int i = 0; i < modelnames.size(); i++){
+        MyObject &object = w.m.find(modelnames[i])->second;
+        double R[12], pos[3];
+        w.backend->getPose(object.body, pos, R);
+        fullBodies[i] = object.body;
+        w.backend->setEnabled(object.body, false);
+        object.body = tierBody(w, modelnames[i], tier);
+        w.backend->setEnabled(object.body, true);
+        if (reportIndex(w, modelnames[i]) >= 0){  //contacts of the coarse body count for the support graph
+          w.reportBodies[object.body] = reportIndex(w, modelnames[i]);
+        }
+        translateObject(w, object, object.center, R);
+      }
+      watchBodies(w, modelnames);
+
+      w.stepSize = TIMESTEP;
+      w.stepIterations = ITERATIONS;
+      int verdict = -1;
+      double worst = 0;
+      int worstObject = 0;
+      for (int c = 0; c < 4 && verdict < 0; c++){
+        runSteps(w, steps[c]);
+        worst = maxDisplacement(w, modelnames, &worstObject);
+        if (worst > THRESHOLD + CASCADE_MARGIN){
+          verdict = 0;
+          noteFailure(w, modelnames[worstObject]);
+        }
+      }
+      if (verdict < 0 && worst < THRESHOLD - CASCADE_MARGIN){
+        verdict = 1;
+      }
+      if (verdict >= 0){  //the coarse tier decided, so report how far its bodies moved
+        noteDisplacements(w, modelnames);
+      }
+
+      //put the full bodies back where the scene started
+      for (int i = 0; i < modelnames.size(); i++){
+        MyObject &object = w.m.find(modelnames[i])->second;
+        double R[12], pos[3];
+        w.backend->getPose(fullBodies[i], pos, R);
+        w.backend->setEnabled(object.body, false);
+        object.body = fullBodies[i];
+        w.backend->setEnabled(object.body, true);
+        translateObject(w, object, object.center, R);
+      }
+
+      if (PRINT_CHKR_RSLT){
+        cout<<(tier == 0 ? "box" : "hull")<<" tier moved "<<worst<<(verdict < 0 ? ", escalating" : "")<<endl;
+      }
+      if (verdict >= 0){
+        if (tier == 0) w.cascade.box++;
+        else w.cascade.hull++;
+        return verdict == 1;
+      }
+    }
+    w.cascade.trimesh++;
+    w.stepSize = TIMESTEP;
+    w.stepIterations = ITERATIONS;
+    return checkScene(w, modelnames);
+}
+
+
+/* simulates the given objects, with the CASCADE if it's on */
+static bool simulateObjects(SimWorld &w, std::vector<string> modelnames){
+    w.reportSteps = 0;  //each COMPONENTS group gets its own support graph steps
+    w.stepSize = TIMESTEP;
+    w.stepIterations = ITERATIONS;
+    if (CASCADE && !DRAW && !modelnames.empty()){
+      return cascadeScene(w, modelnames);
+    }
+    return checkScene(w, modelnames);
+}
+
+
+/* world bounding box of an object at pose, from its hull corners (or its radius if it has no hull) */
+static void posedBounds(MyObject &object, const Eigen::Affine3d &pose, Eigen::Vector3d &lo, Eigen::Vector3d &hi){
+    Eigen::Vector3d c = pose.translation();
+    lo = c - Eigen::Vector3d::Constant(object.radius);
+    hi = c + Eigen::Vector3d::Constant(object.radius);
+    if (!object.hullVertices.empty()){
+      lo = hi = pose * object.hullVertices[0];
+      for (int k = 1; k < object.hullVertices.size(); k++){
+        Eigen::Vector3d p = pose * object.hullVertices[k];
+        lo = lo.cwiseMin(p);
+        hi = hi.cwiseMax(p);
+      }
+    }
+}
+
+
+/* true if two bounding boxes overlap or are less than gap apart along every axis */
+static bool boundsOverlap(const Eigen::Vector3d &lo1, const Eigen::Vector3d &hi1, const Eigen::Vector3d &lo2, const Eigen::Vector3d &hi2, double gap){
+    return (lo1.array() - gap <= hi2.array()).all() && (lo2.array() - gap <= hi1.array()).all();
+}
+
+
+/* Cheap geometric features of a scene for the PreClassifier (PRECLASSIFIER = true), lengths are divided by the objects' radius:
+   0 number of objects
+   1 highest center of mass above the ground plane
+   2 largest gap below an object whose bounding box doesn't overlap any other object's, i.e. it would fall
+   3 smallest support polygon margin of the objects resting on the ground (see supportMargin()), 1 if none does
+   4 deepest an object sinks into the ground
+   5 deepest overlap of two objects' bounding boxes
+   6 pairs of overlapping bounding boxes per object
+   7 largest tilt of an object's up axis (its symmetry axis, or the .obj z axis) away from up, 0 upright to 2 upside down
+   A scene of a few objects takes a few microseconds, mostly posing the hull corners */
+static void sceneFeatures(SimWorld &w, const std::vector<string> &modelnames, const std::vector<Eigen::Affine3d> &model_poses,
+                          double features[PRECLASSIFIER_FEATURES]){
+    int n = modelnames.size();
+    Eigen::Vector3d up = upDirection(w);
+    Eigen::Vector3d normal(w.plane[0], w.plane[1], w.plane[2]);
+    vector<Eigen::Vector3d> lo(n), hi(n);
+    vector<double> radius(n);
+    for (int i = 0; i < n; i++){
+      MyObject &object = w.m.find(modelnames[i])->second;
+      posedBounds(object, model_poses[i], lo[i], hi[i]);
+      radius[i] = std::max(object.radius, 1e-6);
+    }
+
+    features[0] = n;
+    features[1] = 0;
+    features[2] = 0;
+    features[3] = 1;
+    features[4] = 0;
+    features[5] = 0;
+    features[6] = 0;
+    features[7] = 0;
+    for (int i = 0; i < n; i++){
+      MyObject &object = w.m.find(modelnames[i])->second;
+      features[1] = std::max(features[1], (normal.dot(model_poses[i].translation()) - w.plane[3]) / radius[i]);
+
+      bool isolated = true;
+      for (int j = 0; j < n; j++){
+        if (j != i && boundsOverlap(lo[i], hi[i], lo[j], hi[j], 0)){
+          isolated = false;
+          if (j > i){
+            Eigen::Vector3d overlap = hi[i].cwiseMin(hi[j]) - lo[i].cwiseMax(lo[j]);
+            features[5] = std::max(features[5], overlap.minCoeff() / std::min(radius[i], radius[j]));
+            features[6] += 1.0 / n;
+          }
+        }
+      }
+
+      double lowest;
+      double margin = supportMargin(w, object, model_poses[i], lowest);
+      if (lowest < 1e299){
+        if (isolated && lowest > SUPPORT_TOLERANCE){
+          features[2] = std::max(features[2], lowest / radius[i]);
+        }
+        if (std::abs(lowest) <= SUPPORT_TOLERANCE){
+          features[3] = std::min(features[3], margin < -1e299 ? 0 : margin / radius[i]);
+        }
+        features[4] = std::max(features[4], -lowest / radius[i]);
+      }
+
+      std::map<std::string, Eigen::Vector3d>::iterator symmetry = w.symmetryAxes.find(modelnames[i]);
+      Eigen::Vector3d axis = symmetry == w.symmetryAxes.end() ? Eigen::Vector3d(0,0,1) : symmetry->second.normalized();
+      features[7] = std::max(features[7], 1 - up.dot(model_poses[i].linear() * axis));
+    }
+}
+
+
+/* Cache key of a group of objects. Every object adds its name and its pose rounded to CACHE_GRID (position) and
+   CACHE_ANGLE (rotation). For a model with a symmetry axis only the direction of that axis counts, so hypotheses which
+   only differ by a turn about it get the same key. The objects' keys are sorted so their order doesn't matter */
+static string sceneKey(SimWorld &w, const std::vector<string> &modelnames, const std::vector<Eigen::Affine3d> &model_poses, const vector<int> &objects){
+    vector<string> parts;
+    for (int k = 0; k < objects.size(); k++){
+      const string &name = modelnames[objects[k]];
+      const Eigen::Affine3d &pose = model_poses[objects[k]];
+      vector<double> values, steps;
+      for (int r = 0; r < 3; r++){
+        values.push_back(pose.translation()[r]);
+        steps.push_back(CACHE_GRID);
+      }
+      auto axis = w.symmetryAxes.find(name);
+      if (axis != w.symmetryAxes.end()){
+        Eigen::Vector3d direction = pose.linear() * axis->second;
+        for (int r = 0; r < 3; r++){
+          values.push_back(direction[r]);
+          steps.push_back(CACHE_ANGLE);
+        }
+      } else {
+        for (int c = 0; c < 2; c++){  //the third column follows from the first two
+          for (int r = 0; r < 3; r++){
+            values.push_back(pose.linear()(r,c));
+            steps.push_back(CACHE_ANGLE);
+          }
+        }
+      }
+      string part = name;
+      part += '\0';
+      for (int v = 0; v < values.size(); v++){
+        long long q = steps[v] > 0 ? llround(values[v] / steps[v]) : 0;
+        if (steps[v] <= 0){  //no rounding, use the exact value
+          std::memcpy(&q, &values[v], sizeof(q));
+        }
+        part.append((const char*)&q, sizeof(q));
+      }
+      parts.push_back(part);
+    }
+    std::sort(parts.begin(), parts.end());
+    string key;
+    for (int k = 0; k < parts.size(); k++){
+      key += parts[k];
+    }
+    return key;
+}
+
+
+/* COMPONENTS = true. Objects whose bounding boxes, grown by THRESHOLD (the furthest an object may move and still be valid),
+   overlap are connected, and every group of connected objects is simulated on its own with the other groups taken out
+   of the world. With COMPONENT_FAIL_FAST the first invalid group ends the check. Verdicts of groups are cached when
+   CACHE_SIZE > 0 so a group which shows up again in another scene isn't simulated twice */
+static bool componentScenes(SimWorld &w, const std::vector<string> &modelnames, const std::vector<Eigen::Affine3d> &model_poses,
+                            const vector<int> &objects, const vector<Eigen::Vector3d> &lo, const vector<Eigen::Vector3d> &hi){
+    //connected groups with union-find
+    vector<int> parent(objects.size());
+    for (int a = 0; a < objects.size(); a++) parent[a] = a;
+    for (int a = 0; a < objects.size(); a++){
+      for (int b = a+1; b < objects.size(); b++){
+        if (boundsOverlap(lo[objects[a]], hi[objects[a]], lo[objects[b]], hi[objects[b]], 2*THRESHOLD)){  //both may move THRESHOLD towards each other
+          int ra = a, rb = b;
+          while (parent[ra] != ra) ra = parent[ra];
+          while (parent[rb] != rb) rb = parent[rb];
+          parent[ra] = rb;
+        }
+      }
+    }
+    std::map<int,int> group;  //root -> index in w.components
+    for (int a = 0; a < objects.size(); a++){
+      int root = a;
+      while (parent[root] != root) root = parent[root];
+      if (!group.count(root)){
+        group[root] = w.components.size();
+        w.components.push_back(ComponentVerdict());
+      }
+      w.components[group[root]].objects.push_back(objects[a]);
+    }
+
+    //one group at a time, the others are disabled
+    bool valid = true;
+    for (int c = 0; c < w.components.size(); c++){
+      ComponentVerdict &component = w.components[c];
+      string key = sceneKey(w, modelnames, model_poses, component.objects);
+      bool cachedValid;
+      if (w.cache.getCapacity() > 0 && w.cache.find(key, cachedValid)){
+        component.valid = cachedValid;
+        component.cached = true;
+      } else {
+        vector<string> names;
+        for (int k = 0; k < objects.size(); k++){
+          bool inComponent = std::find(component.objects.begin(), component.objects.end(), objects[k]) != component.objects.end();
+          w.backend->setEnabled(w.m.find(modelnames[objects[k]])->second.body, inComponent);
+          if (inComponent){
+            names.push_back(modelnames[objects[k]]);
+          }
+        }
+        component.valid = simulateObjects(w, names);
+        if (!w.stoppedEarly) w.cache.insert(key, component.valid);
+      }
+      component.checked = true;
+      if (PRINT_CHKR_RSLT){
+        cout<<"component "<<c+1<<" of "<<w.components.size()<<" ("<<component.objects.size()<<" objects"<<(component.cached ? ", cached" : "")<<"): "<<(component.valid ? "TRUE" : "FALSE")<<endl;
+      }
+      if (!component.valid){
+        valid = false;
+        if (COMPONENT_FAIL_FAST) break;
+      }
+    }
+    for (int k = 0; k < objects.size(); k++){
+      w.backend->setEnabled(w.m.find(modelnames[objects[k]])->second.body, true);
+    }
+    return valid;
+}
+
+
+/* returns the handle setModels() gave a model, -1 if it wasn't loaded */
+int SceneValidator::getModelHandle(std::string modelname){
+    for (int i = 0; i < sim->numModels; i++){
+      if (sim->obj[i].model_ID == modelname){
+        return i;
+      }
+    }
+    return -1;
+}
+
+
+/* Hot path version of isValidScene(). The objects come straight from obj[] by handle, the poses are read in place and the
+   simulation and checks don't touch any string, map or vector, so once the backend's buffers have grown to the scene's size
+   (after the first call or two) a call makes no heap allocations. The shortcuts which work on names (ANALYTIC,
+   SUPPORT_SHORTCUT, CASCADE, COMPONENTS, the cache and the pre-classifier) and DRAW go through the general isValidScene()
+   instead, which does allocate. getFailureReport() isn't filled in by this path */
+bool SceneValidator::isValidScene(const ModelPose *poses, int count){
+    SimWorld &w = *sim;
+    w.handleScene++;
+    for (int i = 0; i < count; i++){
+      int h = poses[i].handle;
+      if (h < 0 || h >= w.numModels || w.handleMark[h] == w.handleScene){
+        std::cout<<"***ERROR*** in isValidScene(). Handle "<<h<<" isn't a model from setModels() or is used twice"<<endl;
+        return false;
+      }
+      w.handleMark[h] = w.handleScene;
+    }
+    if (ANALYTIC || SUPPORT_SHORTCUT || CASCADE || COMPONENTS || CACHE_SIZE > 0 || PRECLASSIFIER || DRAW){
+      vector<string> modelnames(count);
+      vector<Eigen::Affine3d> model_poses(count);
+      for (int i = 0; i < count; i++){
+        const ModelPose &p = poses[i];
+        modelnames[i] = w.obj[p.handle].model_ID;
+        Eigen::Quaterniond q(p.quaternion[0], p.quaternion[1], p.quaternion[2], p.quaternion[3]);
+        model_poses[i] = Eigen::Translation3d(Eigen::Vector3d(p.position[0], p.position[1], p.position[2])) * Eigen::Affine3d(q.normalized());
+      }
+      return isValidScene(modelnames, model_poses);
+    }
+
+    w.stepSize = TIMESTEP;
+    w.stepIterations = ITERATIONS;
+    w.stats = SimulationStats();
+    w.report.culprit = -1;
+    w.report.objects.clear();
+    w.stoppedEarly = false;
+    w.backend->configure(backendSettings());
+
+    //place the objects, the quaternion (w,x,y,z) becomes ODE's 3x4 rotation matrix
+    w.num = count;
+    for (int i = 0; i < count; i++){
+      const ModelPose &p = poses[i];
+      double qw = p.quaternion[0], qx = p.quaternion[1], qy = p.quaternion[2], qz = p.quaternion[3];
+      double norm = std::sqrt(qw*qw + qx*qx + qy*qy + qz*qz);
+      qw /= norm;  qx /= norm;  qy /= norm;  qz /= norm;
+      const double R[12] = {
+        1 - 2*(qy*qy + qz*qz), 2*(qx*qy - qz*qw),     2*(qx*qz + qy*qw),     0,
+        2*(qx*qy + qz*qw),     1 - 2*(qx*qx + qz*qz), 2*(qy*qz - qx*qw),     0,
+        2*(qx*qz - qy*qw),     2*(qy*qz + qx*qw),     1 - 2*(qx*qx + qy*qy), 0  };
+      translateObject(w, w.obj[p.handle], p.position, R);
+    }
+    w.stepBodies.clear();  //its capacity was reserved by setModels(), so this doesn't allocate
+    for (int i = 0; i < count; i++){
+      w.stepBodies.push_back(w.obj[poses[i].handle].body);
+    }
+
+    //the same four checks as checkScene()
+    const int steps[4] = {STEP1, STEP2, STEP3, STEP4};
+    for (int c = 0; c < 4; c++){
+      runSteps(w, steps[c]);
+      if (w.stoppedEarly){
+        return false;
+      }
+      for (int i = 0; i < count; i++){
+        MyObject &object = w.obj[poses[i].handle];
+        if (!inStaticEquilibrium(w, object.body, object.center, object.model_ID)){
+          if (PRINT_CHKR_RSLT){
+            cout << "FALSE"<<endl;
+          }
+          return false;
+        }
+      }
+    }
+    if (PRINT_CHKR_RSLT){
+      cout << "TRUE"<<endl;
+    }
+    return true;
+}
+
+
+/* checks if a given scene is in static equilibrium or not */
+bool SceneValidator::isValidScene(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses){
+    //start every scene from the same step size and clear the stats
+    SimWorld &w = *sim;
+    w.stepSize = TIMESTEP;
+    w.stepIterations = ITERATIONS;
+    w.stats = SimulationStats();
+    w.components.clear();
+    w.report = FailureReport();
+    w.stoppedEarly = false;
+    w.backend->configure(backendSettings());
+    if (w.cacheGeneration != paramGeneration){  //parameters changed since the verdicts were cached
+      w.cache.clear();
+      w.cache.setCapacity(CACHE_SIZE);
+      w.cacheGeneration = paramGeneration;
+    }
+
+    //the same scene (up to CACHE_GRID, CACHE_ANGLE and symmetry) was already checked
+    string key;
+    if (w.cache.getCapacity() > 0 && !DRAW){
+      vector<int> all(modelnames.size());
+      for (int i = 0; i < all.size(); i++) all[i] = i;
+      key = sceneKey(w, modelnames, model_poses, all);
+      bool cachedValid;
+      if (w.cache.find(key, cachedValid)){
+        w.stats.cached = true;
+        return cachedValid;
+      }
+    }
+
+    //scenes the pre-classifier is sure about aren't simulated
+    if (PRECLASSIFIER && !DRAW && w.preClassifier.trained()){
+      double features[PRECLASSIFIER_FEATURES];
+      sceneFeatures(w, modelnames, model_poses, features);
+      int verdict = w.preClassifier.classify(features);
+      if (verdict >= 0){
+        if (PRINT_CHKR_RSLT){
+          cout<<"pre-classifier: "<<(verdict == 1 ? "TRUE" : "FALSE")<<endl;
+        }
+        w.stats.preclassified = true;
+        if (!key.empty()) w.cache.insert(key, verdict == 1);
+        return verdict == 1;
+      }
+    }
+
+    //set all the Objects's positions
+    w.num = modelnames.size();
+    for (int i =0; i < w.num; i++){
+       auto mappedObject= w.m.find(modelnames[i]);   //get model from hashmap
+       double R[12], center[3];
+       poseToArrays(model_poses[i], center, R);    //convert affine info to a rotation matrix and a x,y,z position array
+       translateObject(w, mappedObject->second, center, R);  //get the model name's MyObject info and feed it the position and rotation
+    }
+    startReport(w, modelnames);
+
+    //posed bounding boxes, used to find objects which can't touch each other
+    vector<Eigen::Vector3d> lo(modelnames.size()), hi(modelnames.size());
+    if (SUPPORT_SHORTCUT || COMPONENTS){
+      for (int i = 0; i < modelnames.size(); i++){
+        posedBounds(w.m.find(modelnames[i])->second, model_poses[i], lo[i], hi[i]);
+      }
+    }
+
+    //objects whose bounding boxes don't touch any other object's are decided by supportCheck() if they can be,
+    //and left out of the simulation
+    vector<int> simulated;  //indices into modelnames of the objects which still have to be simulated
+    vector<int> parked;     //bodies left out of this call's simulation
+    for (int i = 0; i < modelnames.size(); i++){
+      int verdict = -1;
+      if (SUPPORT_SHORTCUT && !DRAW && w.heightfieldHeights.empty()){
+        bool isolated = true;
+        for (int j = 0; j < modelnames.size() && isolated; j++){
+          if (j != i && boundsOverlap(lo[i], hi[i], lo[j], hi[j], SUPPORT_TOLERANCE)){
+            isolated = false;
+          }
+        }
+        verdict = isolated ? supportCheck(w, w.m.find(modelnames[i])->second, model_poses[i]) : -1;
+      }
+      if (verdict >= 0){
+        w.stats.shortcutObjects++;
+      }
+      if (verdict == 0){
+        if (PRINT_CHKR_RSLT){
+          cout<<modelnames[i]<<" falls over (support polygon)"<<endl;
+        }
+        for (int k = 0; k < parked.size(); k++){
+          w.backend->setEnabled(parked[k], true);
+        }
+        w.report.objects[i].restsOn.push_back(-1);  //it was found to stand only on the ground
+        noteFailure(w, modelnames[i]);
+        finishReport(w, modelnames);
+        if (!key.empty()) w.cache.insert(key, false);
+        return false;
+      } else if (verdict == 1){
+        w.report.objects[i].restsOn.push_back(-1);
+        parked.push_back(w.m.find(modelnames[i])->second.body);
+        w.backend->setEnabled(parked.back(), false);
+      } else {
+        simulated.push_back(i);
+      }
+    }
+
+    bool valid;
+    if (COMPONENTS && !DRAW){
+      valid = componentScenes(w, modelnames, model_poses, simulated, lo, hi);
+    } else {
+      vector<string> names;
+      for (int k = 0; k < simulated.size(); k++){
+        names.push_back(modelnames[simulated[k]]);
+      }
+      valid = simulateObjects(w, names);
+    }
+    for (int k = 0; k < parked.size(); k++){
+      w.backend->setEnabled(parked[k], true);
+    }
+    finishReport(w, modelnames);
+    if (!key.empty() && !w.stoppedEarly) w.cache.insert(key, valid);
+    return valid;
+}
+
+
+/* disables every loaded model which isn't in modelnames, so models left wherever they were don't get in the way. Returns their bodies */
+static vector<int> parkUnused(SimWorld &w, const std::vector<string> &modelnames){
+    vector<int> parked;
+    for (auto &entry : w.m){
+      if (std::find(modelnames.begin(), modelnames.end(), entry.first) == modelnames.end()){
+        parked.push_back(entry.second.body);
+        w.backend->setEnabled(entry.second.body, false);
+      }
+    }
+    return parked;
+}
+
+
+/* remembers where the objects are now as the committed scene */
+static void storeCommitted(SimWorld &w, const std::vector<string> &modelnames){
+    w.committed.clear();
+    for (int i = 0; i < modelnames.size(); i++){
+      CommittedObject object;
+      object.model_ID = modelnames[i];
+      w.backend->getPose(w.m.find(modelnames[i])->second.body, object.center, object.R);
+      w.committed.push_back(object);
+    }
+}
+
+
+/* Validates a scene like isValidScene() and, if it's valid, commits it: its objects are kept at the poses they settled at
+   so isValidWithCommitted() can add objects to it without simulating it again from scratch */
+bool SceneValidator::commitScene(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses){
+    SimWorld &w = *sim;
+    if (modelnames.size() != model_poses.size()){
+      std::cout<<"***ERROR*** in commitScene(). modelnames and model_poses must be the same size"<<endl;
+      return false;
+    }
+    for (int i = 0; i < modelnames.size(); i++){
+      if (w.m.find(modelnames[i]) == w.m.end()){
+        std::cout<<"***ERROR*** in commitScene(). "<<modelnames[i]<<" was not loaded with setModels()"<<endl;
+        return false;
+      }
+    }
+    //the committed poses have to be where the objects settled, so the cache, the pre-classifier, ANALYTIC,
+    //SUPPORT_SHORTCUT and CASCADE (whose verdicts leave the trimesh bodies unsimulated) are all skipped
+    w.stepSize = TIMESTEP;
+    w.stepIterations = ITERATIONS;
+    w.stats = SimulationStats();
+    w.components.clear();
+    w.stoppedEarly = false;
+    w.backend->configure(backendSettings());
+    vector<int> parked = parkUnused(w, modelnames);
+    for (int i = 0; i < modelnames.size(); i++){
+      double R[12], center[3];
+      poseToArrays(model_poses[i], center, R);
+      translateObject(w, w.m.find(modelnames[i])->second, center, R);
+    }
+    startReport(w, modelnames);
+    bool valid = checkScene(w, modelnames, false);
+    finishReport(w, modelnames);
+    if (valid && !w.stoppedEarly){
+      storeCommitted(w, modelnames);
+    }
+    for (int k = 0; k < parked.size(); k++){
+      w.backend->setEnabled(parked[k], true);
+    }
+    return valid;
+}
+
+
+/* Checks the committed scene plus one new object. The committed objects start asleep where they settled, so they only
+   move if the new object (or something it pushed) disturbs them, and the simulation costs about as much as the new
+   object does. When commit is true and the result is valid the new object joins the committed scene */
+bool SceneValidator::isValidWithCommitted(std::string modelname, Eigen::Affine3d pose, bool commit){
+    SimWorld &w = *sim;
+    if (w.m.find(modelname) == w.m.end()){
+      std::cout<<"***ERROR*** in isValidWithCommitted(). "<<modelname<<" was not loaded with setModels()"<<endl;
+      return false;
+    }
+    vector<string> modelnames;
+    for (int i = 0; i < w.committed.size(); i++){
+      if (w.committed[i].model_ID == modelname){
+        std::cout<<"***ERROR*** in isValidWithCommitted(). "<<modelname<<" is already in the committed scene"<<endl;
+        return false;
+      }
+      modelnames.push_back(w.committed[i].model_ID);
+    }
+    modelnames.push_back(modelname);
+
+    w.stepSize = TIMESTEP;
+    w.stepIterations = ITERATIONS;
+    w.stats = SimulationStats();
+    w.stoppedEarly = false;
+    w.backend->configure(backendSettings());
+    vector<int> parked = parkUnused(w, modelnames);
+
+    //committed objects asleep at their settled poses, the new one awake at its pose
+    for (int i = 0; i < w.committed.size(); i++){
+      MyObject &object = w.m.find(w.committed[i].model_ID)->second;
+      translateObject(w, object, w.committed[i].center, w.committed[i].R);
+      w.backend->setAsleep(object.body);
+    }
+    double R[12], center[3];
+    poseToArrays(pose, center, R);
+    translateObject(w, w.m.find(modelname)->second, center, R);
+    startReport(w, modelnames);
+
+    bool valid = checkScene(w, modelnames, !commit);  //THRESHOLD is measured from the settled poses. A scene being committed is always simulated
+    finishReport(w, modelnames);
+    if (valid && commit && !w.stoppedEarly){
+      storeCommitted(w, modelnames);
+    }
+
+    for (int i = 0; i < w.committed.size(); i++){  //wake everything up again for the other kinds of checks
+      w.backend->setEnabled(w.m.find(w.committed[i].model_ID)->second.body, true);
+    }
+    for (int k = 0; k < parked.size(); k++){
+      w.backend->setEnabled(parked[k], true);
+    }
+    return valid;
+}
+
+
+/* forgets the committed scene */
+void SceneValidator::clearCommitted(){
+    sim->committed.clear();
+}
+
+
+/* the committed objects' trimeshes in world coordinates, 3 corners per triangle, and all of their vertices */
+static void committedMesh(SimWorld &w, vector<Eigen::Vector3d> &corners, vector<Eigen::Vector3d> &points){
+    for (int i = 0; i < w.committed.size(); i++){
+      MyObject &object = w.m.find(w.committed[i].model_ID)->second;
+      Eigen::Affine3d pose = arraysToPose(w.committed[i].center, w.committed[i].R);
+      int first = points.size();
+      for (int k = 0; k < object.vertCount; k++){
+        const float *v = &object.vertices[3*k];
+        points.push_back(pose * Eigen::Vector3d(v[0], v[1], v[2]));
+      }
+      for (int k = 0; k < 3*object.indCount; k++){
+        corners.push_back(points[first + object.indices[k]]);
+      }
+    }
+}
+
+
+/* true if the object's body, where it is now, sinks more than PLACEMENT_TOLERANCE into the ground or a committed object */
+static bool penetrates(SimWorld &w, int body){
+    const vector<BackendContact> &contacts = w.backend->generateContacts();
+    for (int c = 0; c < contacts.size(); c++){
+      if ((contacts[c].body1 == body || contacts[c].body2 == body) && contacts[c].depth > PLACEMENT_TOLERANCE){
+        return true;
+      }
+    }
+    return false;
+}
+
+
+/* Lowest height (along up, measured from base) where object rests on the committed scene without sinking into it, found by
+   sweeping its trimesh down onto the committed trimeshes and the ground plane. Returns false if there is nothing below it */
+static bool sweepHeight(SimWorld &w, MyObject &object, const Eigen::Matrix3d &rotation, const Eigen::Vector3d &base,
+                        const Eigen::Vector3d &up, double &height){
+    vector<Eigen::Vector3d> sceneCorners, scenePoints;
+    committedMesh(w, sceneCorners, scenePoints);
+
+    //start with the object's lowest point above the scene's highest one (and above the ground plane)
+    vector<Eigen::Vector3d> local(object.vertCount);
+    double low = 1e300;
+    for (int k = 0; k < object.vertCount; k++){
+      const float *v = &object.vertices[3*k];
+      local[k] = rotation * Eigen::Vector3d(v[0], v[1], v[2]) + base;
+      low = std::min(low, up.dot(local[k]));
+    }
+    double top = -1e300;
+    for (int k = 0; k < scenePoints.size(); k++){
+      top = std::max(top, up.dot(scenePoints[k]));
+    }
+    Eigen::Vector3d normal(w.plane[0], w.plane[1], w.plane[2]);
+    double facing = normal.dot(up);  //how much the ground faces up, it can only be landed on if this is positive
+    double start = scenePoints.empty() ? 0 : std::max(0.0, top - low);
+    if (facing > 1e-9){
+      double lowest = 1e300;
+      for (int k = 0; k < local.size(); k++){
+        lowest = std::min(lowest, normal.dot(local[k]) - w.plane[3]);
+      }
+      start = std::max(start, -lowest / facing);
+    }
+    start += 1.0;
+
+    //how far it falls from there, the scene's vertices are swept up into the object as well so sharp tips aren't missed
+    vector<Eigen::Vector3d> points(local.size()), corners;
+    for (int k = 0; k < local.size(); k++){
+      points[k] = local[k] + start*up;
+    }
+    for (int k = 0; k < 3*object.indCount; k++){
+      corners.push_back(points[object.indices[k]]);
+    }
+    double fall = sweepDistance(points, sceneCorners, -up);
+    double rise = sweepDistance(scenePoints, corners, up);
+    if (rise >= 0 && (fall < 0 || rise < fall)){
+      fall = rise;
+    }
+    if (facing > 1e-9){
+      for (int k = 0; k < points.size(); k++){
+        double ground = (normal.dot(points[k]) - w.plane[3]) / facing;
+        if (fall < 0 || ground < fall){
+          fall = ground;
+        }
+      }
+    }
+    if (fall < 0){
+      return false;
+    }
+    height = start - fall;
+    return true;
+}
+
+
+/* Lowest height (along up, measured from base) where object's body doesn't sink into the committed scene or the ground,
+   bracketed and then bisected with the backend's own collision detection. Returns false if there is nothing below it */
+static bool bisectHeight(SimWorld &w, MyObject &object, const double R[12], const Eigen::Vector3d &base,
+                         const Eigen::Vector3d &up, double &height){
+    vector<string> modelnames;
+    for (int i = 0; i < w.committed.size(); i++){
+      MyObject &other = w.m.find(w.committed[i].model_ID)->second;
+      translateObject(w, other, w.committed[i].center, w.committed[i].R);
+      modelnames.push_back(w.committed[i].model_ID);
+    }
+    modelnames.push_back(object.model_ID);
+    vector<int> parked = parkUnused(w, modelnames);
+
+    //start above everything that is committed
+    double hi = 0;
+    for (int i = 0; i < w.committed.size(); i++){
+      Eigen::Vector3d c(w.committed[i].center[0], w.committed[i].center[1], w.committed[i].center[2]);
+      MyObject &other = w.m.find(w.committed[i].model_ID)->second;
+      hi = std::max(hi, up.dot(c - base) + other.radius);
+    }
+    hi += object.radius + PLACEMENT_TOLERANCE;
+    double center[3];
+    Eigen::Vector3d p;
+    for (int tries = 0; ; tries++){  //the ground (or a support surface) can be higher than the committed objects
+      p = base + hi*up;
+      for (int k = 0; k < 3; k++) center[k] = p[k];
+      translateObject(w, object, center, R);
+      if (!penetrates(w, object.body)) break;
+      if (tries == 30){
+        for (int k = 0; k < parked.size(); k++) w.backend->setEnabled(parked[k], true);
+        return false;
+      }
+      hi += std::max(object.radius, PLACEMENT_TOLERANCE);
+    }
+
+    //step down a quarter of the object's size at a time until it touches something, so thin rims aren't jumped over
+    double step = std::max(object.radius / 4, PLACEMENT_TOLERANCE);
+    double lo = hi;
+    bool found = false;
+    for (int tries = 0; tries < 400 && !found; tries++){
+      lo -= step;
+      p = base + lo*up;
+      for (int k = 0; k < 3; k++) center[k] = p[k];
+      translateObject(w, object, center, R);
+      if (penetrates(w, object.body)){
+        found = true;
+      } else {
+        hi = lo;
+      }
+    }
+
+    //then bisect the bracket
+    while (found && hi - lo > PLACEMENT_TOLERANCE){
+      double mid = (lo + hi) / 2;
+      p = base + mid*up;
+      for (int k = 0; k < 3; k++) center[k] = p[k];
+      translateObject(w, object, center, R);
+      if (penetrates(w, object.body)){
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    for (int k = 0; k < parked.size(); k++){
+      w.backend->setEnabled(parked[k], true);
+    }
+    height = hi;
+    return found;
+}
+
+
+/* Finds the lowest height at which an object at pose's x, y and orientation rests on the committed scene, then checks it
+   there with one isValidWithCommitted(). The default sweeps the object's trimesh down onto the committed trimeshes and the
+   ground plane (a few milliseconds). PLACEMENT_BISECT uses the backend's collision detection instead, which takes a few
+   dozen collision queries but sees exactly what the simulation sees: use it with a support surface or with a backend whose
+   collision shapes aren't the trimesh */
+bool SceneValidator::findPlacement(std::string modelname, Eigen::Affine3d &pose, bool commit){
+    SimWorld &w = *sim;
+    if (w.m.find(modelname) == w.m.end()){
+      std::cout<<"***ERROR*** in findPlacement(). "<<modelname<<" was not loaded with setModels()"<<endl;
+      return false;
+    }
+    for (int i = 0; i < w.committed.size(); i++){
+      if (w.committed[i].model_ID == modelname){
+        std::cout<<"***ERROR*** in findPlacement(). "<<modelname<<" is already in the committed scene"<<endl;
+        return false;
+      }
+    }
+    MyObject &object = w.m.find(modelname)->second;
+    Eigen::Vector3d up = upDirection(w);
+    Eigen::Vector3d base = pose.translation() - up * up.dot(pose.translation());  //height 0 below (or above) pose
+    double center[3], R[12];
+    poseToArrays(pose, center, R);
+
+    double height;
+    bool found;
+    if (PLACEMENT_BISECT || !w.heightfieldHeights.empty()){
+      w.backend->configure(backendSettings());
+      found = bisectHeight(w, object, R, base, up, height);
+    } else {
+      found = sweepHeight(w, object, pose.linear(), base, up, height);
+    }
+    if (!found){
+      if (PRINT_CHKR_RSLT){
+        cout<<modelname<<" has nothing to rest on below it"<<endl;
+      }
+      return false;
+    }
+    pose.translation() = base + height*up;
+    return isValidWithCommitted(modelname, pose, commit);
+}
+
+
+/* Simulates a scene until it comes to rest (SETTLE_SPEED, SETTLE_QUIET) or SETTLE_STEPS steps pass, and reads back where
+   every object ended up. A hypothesis which was only a few millimeters off settles into a plausible scene which can be used
+   as it is, instead of being thrown away like an invalid verdict from isValidScene() would */
+bool SceneValidator::settleScene(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses,
+                                 std::vector<Eigen::Affine3d> &settled_poses, std::vector<double> &displacements){
+    SimWorld &w = *sim;
+    if (modelnames.size() != model_poses.size()){
+      std::cout<<"***ERROR*** in settleScene(). modelnames and model_poses must be the same size"<<endl;
+      return false;
+    }
+    for (int i = 0; i < modelnames.size(); i++){
+      if (w.m.find(modelnames[i]) == w.m.end()){
+        std::cout<<"***ERROR*** in settleScene(). "<<modelnames[i]<<" was not loaded with setModels()"<<endl;
+        return false;
+      }
+    }
+    w.stepSize = TIMESTEP;
+    w.stepIterations = ITERATIONS;
+    w.stats = SimulationStats();
+    w.backend->configure(backendSettings());
+    vector<int> parked = parkUnused(w, modelnames);
+
+    w.num = modelnames.size();
+    for (int i = 0; i < modelnames.size(); i++){
+      double R[12], center[3];
+      poseToArrays(model_poses[i], center, R);
+      translateObject(w, w.m.find(modelnames[i])->second, center, R);
+    }
+    watchBodies(w, modelnames);
+
+    //step until every object has been slow for SETTLE_QUIET steps in a row
+    int quiet = 0;
+    while (quiet < SETTLE_QUIET && w.stats.steps < SETTLE_STEPS){
+      simLoop(w, 0);
+      bool still = true;
+      for (int i = 0; i < modelnames.size() && still; i++){
+        MyObject &object = w.m.find(modelnames[i])->second;
+        double v[3], a[3];
+        w.backend->getVelocity(object.body, v, a);
+        double speed = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]) + object.radius * std::sqrt(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]);
+        still = speed < SETTLE_SPEED;
+      }
+      quiet = still ? quiet + 1 : 0;
+    }
+
+    //final poses straight from the backend, and how far each center of mass moved
+    settled_poses.resize(modelnames.size());
+    displacements.resize(modelnames.size());
+    for (int i = 0; i < modelnames.size(); i++){
+      double R[12], center[3];
+      w.backend->getPose(w.m.find(modelnames[i])->second.body, center, R);
+      settled_poses[i] = arraysToPose(center, R);
+      displacements[i] = (settled_poses[i].translation() - model_poses[i].translation()).norm();
+      if (PRINT_DELTA_POS){
+        cout<<modelnames[i]<<" settled "<<displacements[i]<<" away"<<endl;
+      }
+    }
+    for (int k = 0; k < parked.size(); k++){
+      w.backend->setEnabled(parked[k], true);
+    }
+    return quiet >= SETTLE_QUIET;
+}
+
+
+/* the body of a model in hypothesis k of isValidScenes(). Hypothesis 0 uses the model's own body, the others use copies
+   which are made the first time they're needed and kept for later calls */
+static int hypothesisBody(SimWorld &w, const string &name, int k){
+    MyObject &object = w.m.find(name)->second;
+    if (k == 0){
+      return object.body;
+    }
+    vector<int> &copies = w.copyBodies[name];
+    while (copies.size() < k){
+      for (int i = 0; i < w.numModels; i++){  //the backend references the mesh arrays, so use the ones in obj[] which live as long as the world
+        if (w.obj[i].model_ID == name){
+          copies.push_back(w.backend->createBody(w.obj[i].vertices, w.obj[i].vertCount, w.obj[i].indices, w.obj[i].indCount, DENSITY));
+          w.backend->setEnabled(copies.back(), false);
+          break;
+        }
+      }
+    }
+    return copies[k-1];
+}
+
+
+/* Checks many pose hypotheses of the same models at once. Up to COLLISION_GROUPS hypotheses are put into the world
+   together, each in its own collision group so they never touch each other but all stand on the same ground. They are
+   stepped together and checked after each of the four checks, a hypothesis that fails is taken out of the world */
+std::vector<bool> SceneValidator::isValidScenes(std::vector<string> modelnames, std::vector< std::vector<Eigen::Affine3d> > hypotheses){
+    SimWorld &w = *sim;
+    std::vector<bool> valid(hypotheses.size(), false);
+    for (int i = 0; i < modelnames.size(); i++){
+      if (w.m.find(modelnames[i]) == w.m.end()){
+        std::cout<<"***ERROR*** in isValidScenes(). "<<modelnames[i]<<" was not loaded with setModels()"<<endl;
+        return valid;
+      }
+    }
+    for (int h = 0; h < hypotheses.size(); h++){
+      if (hypotheses[h].size() != modelnames.size()){
+        std::cout<<"***ERROR*** in isValidScenes(). Every hypothesis needs one pose per model name"<<endl;
+        return valid;
+      }
+    }
+
+    w.stats = SimulationStats();
+    w.backend->configure(backendSettings());
+    w.num = modelnames.size();
+    int steps[4] = {STEP1, STEP2, STEP3, STEP4};
+
+    for (int first = 0; first < hypotheses.size(); first += COLLISION_GROUPS){
+      int count = std::min((int)hypotheses.size() - first, COLLISION_GROUPS);
+
+      //put this batch of hypotheses into the world
+      vector<int> bodies(count * w.num);         //bodies[k*num + i] is model i in hypothesis first+k
+      vector<double> centers(count * w.num * 3); //their starting positions
+      vector<bool> active(count, true);
+      for (int k = 0; k < count; k++){
+        for (int i = 0; i < w.num; i++){
+          int body = hypothesisBody(w, modelnames[i], k);
+          double R[12];
+          poseToArrays(hypotheses[first+k][i], &centers[3*(k*w.num + i)], R);
+          w.backend->setCollisionGroup(body, k);
+          w.backend->setEnabled(body, true);
+          w.backend->setPose(body, &centers[3*(k*w.num + i)], R);
+          bodies[k*w.num + i] = body;
+        }
+      }
+
+      //same checks as isValidScene(), but every hypothesis still in the world is checked after each of them
+      w.stepSize = TIMESTEP;
+      w.stepIterations = ITERATIONS;
+      int remaining = count;
+      for (int c = 0; c < 4 && remaining > 0; c++){
+        w.stepBodies.clear();  //only the hypotheses still in the world
+        for (int k = 0; k < count; k++){
+          if (active[k]) w.stepBodies.insert(w.stepBodies.end(), bodies.begin() + k*w.num, bodies.begin() + (k+1)*w.num);
+        }
+        runSteps(w, steps[c]);
+        for (int k = 0; k < count; k++){
+          if (!active[k]) continue;
+          for (int i = 0; i < w.num; i++){
+            if (!inStaticEquilibrium(w, bodies[k*w.num + i], &centers[3*(k*w.num + i)], modelnames[i])){
+              active[k] = false;
+              break;
+            }
+          }
+          if (!active[k]){  //retire it so it costs nothing in the remaining steps
+            remaining--;
+            for (int i = 0; i < w.num; i++){
+              w.backend->setEnabled(bodies[k*w.num + i], false);
+            }
+          }
+        }
+        if (PRINT_CHKR_RSLT){
+          cout<<"check "<<c+1<<": "<<remaining<<" of "<<count<<" hypotheses still valid"<<endl;
+        }
+      }
+      for (int k = 0; k < count; k++){
+        valid[first+k] = active[k];
+      }
+
+      //leave the world the way isValidScene() expects it: the models' own bodies enabled in group 0, copies disabled
+      for (int k = 0; k < count; k++){
+        for (int i = 0; i < w.num; i++){
+          w.backend->setCollisionGroup(bodies[k*w.num + i], 0);
+          w.backend->setEnabled(bodies[k*w.num + i], k == 0);
+        }
+      }
+    }
+    return valid;
+}
+
+
+/* replaces the ground plane with a heightfield made from a grid of heights */
+bool SceneValidator::setSupportSurface(const std::vector<double> &heights, int widthSamples, int depthSamples, double width, double depth, Eigen::Affine3d pose){
+  if (widthSamples < 2 || depthSamples < 2 || heights.size() != widthSamples*depthSamples){
+    std::cout<<"***ERROR*** in setSupportSurface(). heights must have widthSamples*depthSamples values and each side needs at least 2 samples"<<endl;
+    return false;
+  }
+  stopAsync(false);
+  sim->backend->clearSupportSurface();
+  sim->cache.clear();
+  sim->heightfieldHeights = heights;  //the backend keeps a pointer to these instead of copying them
+  sim->heightfieldSamples[0] = widthSamples;
+  sim->heightfieldSamples[1] = depthSamples;
+  sim->heightfieldSize[0] = width;
+  sim->heightfieldSize[1] = depth;
+  sim->heightfieldRotation = pose.linear();
+  sim->heightfieldPosition = pose.translation();
+
+  //ODE's heightfield is "y up", so turn it 90 degrees about x to make it "z up" before applying the user's pose.
+  //Afterwards the grid's columns run along +x and its rows along -y, just like an image seen from above
+  Eigen::Matrix3d zUp;
+  zUp << 1, 0,  0,
+         0, 0, -1,
+         0, 1,  0;
+  Eigen::Matrix3d r = pose.linear() * zUp;
+  const double R[12] = {
+    r(0,0), r(0,1), r(0,2), 0,
+    r(1,0), r(1,1), r(1,2), 0,
+    r(2,0), r(2,1), r(2,2), 0  };
+  const double position[3] = {pose.translation()[0], pose.translation()[1], pose.translation()[2]};
+
+  if (!sim->backend->setSupportSurface(sim->heightfieldHeights.data(), widthSamples, depthSamples, width, depth, HEIGHTFIELD_THICKNESS, position, R)){
+    std::cout<<"***ERROR*** in setSupportSurface(). This physics backend doesn't support heightfields"<<endl;
+    return false;
+  }
+  return true;
+}
+
+
+/* rewrites the heightfield's heights in place, grid size and pose stay the same */
+bool SceneValidator::updateSupportSurface(const std::vector<double> &heights){
+  if (sim->heightfieldHeights.empty() || heights.size() != sim->heightfieldHeights.size()){
+    std::cout<<"***ERROR*** in updateSupportSurface(). Call setSupportSurface() first and keep the same number of samples"<<endl;
+    return false;
+  }
+  stopAsync(false);
+  std::copy(heights.begin(), heights.end(), sim->heightfieldHeights.begin());  //same buffer so the backend's pointer stays valid
+  sim->cache.clear();
+  return sim->backend->updateSupportSurface();
+}
+
+
+/* removes the heightfield and goes back to using the ground plane */
+void SceneValidator::clearSupportSurface(){
+  stopAsync(false);
+  sim->backend->clearSupportSurface();
+  sim->cache.clear();
+  sim->heightfieldHeights.clear();
+}
+
+
+/* the PreClassifier's features of a scene, for logging scenes and training the classifier */
+std::vector<double> SceneValidator::getSceneFeatures(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses){
+  for (int i = 0; i < modelnames.size(); i++){
+    if (sim->m.find(modelnames[i]) == sim->m.end()){
+      std::cout<<"***ERROR*** in getSceneFeatures(). "<<modelnames[i]<<" was not loaded with setModels()"<<endl;
+      return std::vector<double>();
+    }
+  }
+  double features[PRECLASSIFIER_FEATURES];
+  sceneFeatures(*sim, modelnames, model_poses, features);
+  return std::vector<double>(features, features + PRECLASSIFIER_FEATURES);
+}
+
+
+/* loads a classifier saved by PreClassifier::save(), used when PRECLASSIFIER is on */
+bool SceneValidator::loadPreClassifier(std::string filename){
+  stopAsync(false);
+  if (!sim->preClassifier.load(filename)){
+    std::cout<<"***ERROR*** in loadPreClassifier(). Couldn't read a pre-classifier from "<<filename<<endl;
+    return false;
+  }
+  sim->cache.clear();  //cached verdicts were made without it
+  return true;
+}
+
+
+/* returns which objects failed in the last isValidScene() or isValidWithCommitted() and what rests on what */
+FailureReport SceneValidator::getFailureReport(){
+  return sim->report;
+}
+
+
+/* returns the groups of objects checked by the last isValidScene() call when COMPONENTS is on */
+std::vector<ComponentVerdict> SceneValidator::getComponentVerdicts(){
+  return sim->components;
+}
+
+
+/* declares that turning model about axis (in the model's .obj frame, through its center of mass) doesn't change it */
+bool SceneValidator::setSymmetryAxis(std::string model, Eigen::Vector3d axis){
+  stopAsync(false);
+  if (sim->m.find(model) == sim->m.end()){
+    std::cout<<"***ERROR*** in setSymmetryAxis(). "<<model<<" was not loaded with setModels()"<<endl;
+    return false;
+  }
+  if (axis.norm() == 0){
+    sim->symmetryAxes.erase(model);
+  } else {
+    sim->symmetryAxes[model] = axis.normalized();
+  }
+  sim->cache.clear();
+  return true;
+}
+
+
+/* returns the verdict cache's counters */
+CacheStats SceneValidator::getCacheStats(){
+  CacheStats cacheStats;
+  cacheStats.hits = sim->cache.hits;
+  cacheStats.misses = sim->cache.misses;
+  cacheStats.size = sim->cache.size();
+  return cacheStats;
+}
+
+
+/* returns how many scenes each CASCADE tier decided */
+CascadeStats SceneValidator::getCascadeStats(){
+  return sim->cascade;
+}
+
+
+/* returns the steps, timesteps and solver iterations used by the last isValidScene() call */
+SimulationStats SceneValidator::getSimulationStats(){
+  return sim->stats;
+}
+
+
+/* swaps the physics engine, models which are already loaded are rebuilt in the new one */
+void SceneValidator::setBackend(PhysicsBackend *backend){
+  stopAsync(false);
+  clearSupportSurface();
+  delete sim->backend;
+  sim->backend = backend;
+  sim->backend->setGravity(sim->gravity[0], sim->gravity[1], sim->gravity[2]);
+  sim->backend->setGroundPlane(sim->plane[0], sim->plane[1], sim->plane[2], sim->plane[3]);
+  sim->copyBodies.clear();  //copies and coarse bodies are made again in the new backend when needed
+  sim->tierBodies.clear();
+  for (int i = 0; i < sim->numModels; i++){
+    makeObject(*sim, sim->obj[i]);
+    sim->m[sim->obj[i].model_ID].body = sim->obj[i].body;
+  }
+}
+
+
+/* Sets the budget of the next call, a deadline milliseconds from now and at most steps simulation steps (0 means no limit) */
+static void startBudget(SimWorld &w, double milliseconds, int steps){
+  w.stepBudget = steps;
+  w.hasDeadline = milliseconds > 0;
+  w.deadline = chrono::steady_clock::now() + chrono::microseconds((long)(milliseconds * 1000));
+}
+
+
+/* Three state verdict of the call that just ran with a budget, and ends the budget. Out of budget it's still invalid if an
+   object already moved more than THRESHOLD, otherwise undecided */
+static SceneVerdict budgetVerdict(SimWorld &w, bool valid){
+  SceneVerdict verdict;
+  for (int i = 0; i < w.report.objects.size(); i++){
+    verdict.maxDisplacement = std::max(verdict.maxDisplacement, w.report.objects[i].displacement);
+  }
+  verdict.steps = w.stats.steps;
+  verdict.outOfBudget = w.stoppedEarly && !(w.cancel && w.cancel->load());
+  if (verdict.outOfBudget){
+    verdict.verdict = verdict.maxDisplacement > THRESHOLD ? 0 : -1;
+  } else {
+    verdict.verdict = valid ? 1 : 0;
+  }
+  w.stepBudget = 0;
+  w.hasDeadline = false;
+  return verdict;
+}
+
+
+/* isValidScene() which gives up when its budget runs out */
+SceneVerdict SceneValidator::isValidScene(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses, SceneBudget budget){
+  startBudget(*sim, budget.milliseconds, budget.steps);
+  bool valid = isValidScene(modelnames, model_poses);
+  return budgetVerdict(*sim, valid);
+}
+
+
+/* a scene waiting for (or being simulated by) an async worker */
+struct AsyncJob {
+  SceneTicket ticket;
+  int priority;
+  vector<string> modelnames;
+  vector<Eigen::Affine3d> model_poses;
+  std::function<void(AsyncVerdict)> done;      //called by the worker thread with the verdict
+  std::shared_ptr< std::atomic<bool> > cancel; //cancelScene() sets it, the simulation checks it between steps
+  int  steps;                                  //step budget of the scene, 0 for none
+  bool hasDeadline;                            //the scene has to be done by deadline (a batch's deadline, see isValidScenesWithin())
+  chrono::steady_clock::time_point deadline;
+};
+
+
+/* The workers behind isValidSceneAsync(). Each worker thread makes its own SceneValidator (so its own ODE thread data and
+   world) with the owner's models, scales, symmetry axes, support surface and pre-classifier, and takes the scene with the
+   highest priority (the oldest first among equals) off the queue */
+struct AsyncExecutor {
+  SceneValidator *owner;
+  vector<std::thread> workers;
+  std::map< std::pair<int,SceneTicket>, AsyncJob > queue;  //ordered by (-priority, ticket) so begin() is next
+  std::map< SceneTicket, std::shared_ptr< std::atomic<bool> > > running;
+  std::mutex mutex;
+  std::condition_variable wake;            //a scene was queued or the workers have to stop
+  std::condition_variable room;            //a scene was taken off the queue
+  SceneTicket nextTicket;
+  int limit;                               //ASYNC_QUEUE when the executor was made
+  bool quit;
+
+  AsyncExecutor(SceneValidator *owner) : owner(owner), nextTicket(1), limit(ASYNC_QUEUE), quit(false){
+    for (int i = 0; i < ASYNC_THREADS; i++){
+      workers.push_back(std::thread(&AsyncExecutor::work, this));
+    }
+  }
+
+  /* a worker thread */
+  void work(){
+    SimWorld &o = *owner->sim;
+    SceneValidator *validator = new SceneValidator(o.gravity[0], o.gravity[1], o.gravity[2], o.plane[0], o.plane[1], o.plane[2], o.plane[3], DEFAULT_SCALE);
+    SimWorld &w = *validator->sim;
+    validator->setBackend(o.backend->emptyCopy());  //the same engine as the owner, before any model is made
+    std::copy(o.scaling, o.scaling + NUM, w.scaling);
+    w.symmetryAxes = o.symmetryAxes;
+    w.preClassifier = o.preClassifier;
+    if (!o.modelNames.empty()){
+      validator->setModels(o.modelNames, o.modelFiles);
+    }
+    if (!o.heightfieldHeights.empty()){
+      Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+      pose.linear() = o.heightfieldRotation;
+      pose.translation() = o.heightfieldPosition;
+      validator->setSupportSurface(o.heightfieldHeights, o.heightfieldSamples[0], o.heightfieldSamples[1], o.heightfieldSize[0], o.heightfieldSize[1], pose);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true){
+      wake.wait(lock, [this]{ return quit || !queue.empty(); });
+      if (queue.empty()){  //quit and nothing left to do
+        break;
+      }
+      AsyncJob job = queue.begin()->second;
+      queue.erase(queue.begin());
+      running[job.ticket] = job.cancel;
+      room.notify_one();
+      lock.unlock();
+
+      AsyncVerdict verdict;
+      if (!job.cancel->load()){
+        w.cancel = job.cancel.get();
+        w.stepBudget = job.steps;
+        w.hasDeadline = job.hasDeadline;
+        w.deadline = job.deadline;
+        if (job.hasDeadline && chrono::steady_clock::now() >= job.deadline){  //the batch ran out of time before this one started
+          verdict.undecided = true;
+        } else {
+          SceneVerdict result = budgetVerdict(w, validator->isValidScene(job.modelnames, job.model_poses));
+          verdict.valid = result.verdict == 1;
+          verdict.undecided = result.verdict == -1;
+          verdict.maxDisplacement = result.maxDisplacement;
+        }
+        w.stepBudget = 0;
+        w.hasDeadline = false;
+        w.cancel = 0;
+      }
+      verdict.cancelled = job.cancel->load();
+      if (verdict.cancelled){
+        verdict.valid = false;
+        verdict.undecided = false;
+      }
+      job.done(verdict);
+
+      lock.lock();
+      running.erase(job.ticket);
+    }
+    lock.unlock();
+    delete validator;
+  }
+
+  /* queues a scene, waiting for room if the queue is full */
+  SceneTicket submit(AsyncJob job){
+    std::unique_lock<std::mutex> lock(mutex);
+    room.wait(lock, [this]{ return queue.size() < limit; });
+    job.ticket = nextTicket++;
+    job.cancel = std::make_shared< std::atomic<bool> >(false);
+    queue[std::make_pair(-job.priority, job.ticket)] = job;
+    wake.notify_one();
+    return job.ticket;
+  }
+
+  /* cancels a queued or running scene, false if it already finished (or never existed) */
+  bool cancel(SceneTicket ticket){
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto queued = queue.begin(); queued != queue.end(); ++queued){
+      if (queued->first.second == ticket){
+        AsyncJob job = queued->second;
+        queue.erase(queued);
+        room.notify_one();
+        lock.unlock();
+        AsyncVerdict verdict;
+        verdict.cancelled = true;
+        job.done(verdict);
+        return true;
+      }
+    }
+    auto found = running.find(ticket);
+    if (found == running.end()){
+      return false;
+    }
+    found->second->store(true);
+    return true;
+  }
+
+  /* Stops the workers. With cancelAll everything still queued or running is cancelled, otherwise it is finished first */
+  void stop(bool cancelAll){
+    std::unique_lock<std::mutex> lock(mutex);
+    vector<AsyncJob> dropped;
+    if (cancelAll){
+      for (auto queued = queue.begin(); queued != queue.end(); ++queued){
+        dropped.push_back(queued->second);
+      }
+      queue.clear();
+      for (auto r = running.begin(); r != running.end(); ++r){
+        r->second->store(true);
+      }
+    }
+    quit = true;
+    wake.notify_all();
+    room.notify_all();
+    lock.unlock();
+    for (int i = 0; i < dropped.size(); i++){
+      AsyncVerdict verdict;
+      verdict.cancelled = true;
+      dropped[i].done(verdict);
+    }
+    for (int i = 0; i < workers.size(); i++){
+      workers[i].join();
+    }
+  }
+};
+
+
+/* queues a scene for the async workers, the verdict goes to done */
+SceneTicket SceneValidator::isValidSceneAsync(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses,
+                                              std::function<void(AsyncVerdict)> done, int priority){
+  if (modelnames.size() != model_poses.size()){
+    std::cout<<"***ERROR*** in isValidSceneAsync(). modelnames and model_poses must be the same size"<<endl;
+    return 0;
+  }
+  for (int i = 0; i < modelnames.size(); i++){
+    if (sim->m.find(modelnames[i]) == sim->m.end()){
+      std::cout<<"***ERROR*** in isValidSceneAsync(). "<<modelnames[i]<<" was not loaded with setModels()"<<endl;
+      return 0;
+    }
+  }
+  if (!executor){
+    executor = new AsyncExecutor(this);
+  }
+  AsyncJob job;
+  job.priority = priority;
+  job.modelnames = modelnames;
+  job.model_poses = model_poses;
+  job.done = done;
+  job.steps = 0;
+  job.hasDeadline = false;
+  return executor->submit(job);
+}
+
+
+/* queues a scene for the async workers, the verdict arrives through the future */
+std::future<AsyncVerdict> SceneValidator::isValidSceneAsync(std::vector<string> modelnames, std::vector<Eigen::Affine3d> model_poses,
+                                                            int priority, SceneTicket *ticket){
+  std::shared_ptr< std::promise<AsyncVerdict> > promise = std::make_shared< std::promise<AsyncVerdict> >();
+  std::future<AsyncVerdict> future = promise->get_future();
+  SceneTicket t = isValidSceneAsync(modelnames, model_poses, [promise](AsyncVerdict verdict){ promise->set_value(verdict); }, priority);
+  if (t == 0){  //bad arguments, already reported
+    promise->set_value(AsyncVerdict());
+  }
+  if (ticket){
+    *ticket = t;
+  }
+  return future;
+}
+
+
+/* Verdicts of a batch (isValidScenesWithin(), firstValidScenes()), handed over from the worker threads */
+struct SearchState {
+  std::mutex mutex;
+  std::condition_variable finished;
+  vector< std::pair<int,AsyncVerdict> > verdicts;  //(candidate, verdict) not yet looked at by the search
+};
+
+
+/* Checks a batch of candidates, best first, on the async workers within one budget for the whole batch: every candidate has
+   to be finished by the batch's deadline and may take at most budget.steps steps. Invalid candidates usually fail their first
+   check, so most of the time goes to the promising ones. Candidates the deadline cuts off (or which never start) are undecided */
+std::vector<SceneVerdict> SceneValidator::isValidScenesWithin(std::vector<string> modelnames, std::vector< std::vector<Eigen::Affine3d> > candidates,
+                                                               SceneBudget budget){
+  std::vector<SceneVerdict> verdicts(candidates.size());
+  for (int i = 0; i < modelnames.size(); i++){
+    if (sim->m.find(modelnames[i]) == sim->m.end()){
+      std::cout<<"***ERROR*** in isValidScenesWithin(). "<<modelnames[i]<<" was not loaded with setModels()"<<endl;
+      return verdicts;
+    }
+  }
+  if (!executor){
+    executor = new AsyncExecutor(this);
+  }
+  std::shared_ptr<SearchState> state = std::make_shared<SearchState>();
+  chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::microseconds((long)(budget.milliseconds * 1000));
+  int waiting = 0;
+  for (int c = 0; c < candidates.size(); c++){
+    verdicts[c].verdict = -1;
+    if (candidates[c].size() != modelnames.size()){
+      std::cout<<"***ERROR*** in isValidScenesWithin(). Every candidate needs one pose per model name"<<endl;
+      continue;
+    }
+    AsyncJob job;
+    job.priority = -c;  //best first
+    job.modelnames = modelnames;
+    job.model_poses = candidates[c];
+    job.steps = budget.steps;
+    job.hasDeadline = budget.milliseconds > 0;
+    job.deadline = deadline;
+    job.done = [state, c](AsyncVerdict verdict){
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->verdicts.push_back(std::make_pair(c, verdict));
+      state->finished.notify_one();
+    };
+    executor->submit(job);
+    waiting++;
+  }
+
+  //collect the verdicts
+  while (waiting > 0){
+    vector< std::pair<int,AsyncVerdict> > done;
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->finished.wait(lock, [&state]{ return !state->verdicts.empty(); });
+      done.swap(state->verdicts);
+    }
+    for (int i = 0; i < done.size(); i++){
+      SceneVerdict &verdict = verdicts[done[i].first];
+      verdict.verdict = done[i].second.undecided ? -1 : (done[i].second.valid ? 1 : 0);
+      verdict.outOfBudget = done[i].second.undecided;
+      verdict.maxDisplacement = done[i].second.maxDisplacement;
+      waiting--;
+    }
+  }
+  return verdicts;
+}
+
+
+/* Checks candidates from next in rank order on the async workers until the first k valid ones are known. Only about two
+   candidates per worker are in flight at a time and nothing more is pulled from next once k are valid. Then every running
+   candidate ranked below the k-th valid one is cancelled, so it stops at its next simulation step */
+std::vector<int> SceneValidator::firstValidScenes(std::vector<string> modelnames, std::function<bool(std::vector<Eigen::Affine3d>&)> next,
+                                                  int k, std::vector< std::vector<Eigen::Affine3d> > *accepted){
+  std::shared_ptr<SearchState> state = std::make_shared<SearchState>();
+  std::map<int, SceneTicket> inFlight;                      //candidate -> ticket
+  std::map<int, vector<Eigen::Affine3d> > candidates;       //poses of the candidates which are in flight or valid
+  std::set<int> valid;
+  int window = 2 * std::max(1, ASYNC_THREADS);
+  int pulled = 0;
+  bool exhausted = (k <= 0);
+
+  while (true){
+    //pull more candidates while the answer is still open
+    while (!exhausted && valid.size() < k && inFlight.size() < window){
+      vector<Eigen::Affine3d> poses;
+      if (!next(poses)){
+        exhausted = true;
+        break;
+      }
+      int index = pulled++;
+      SceneTicket ticket = isValidSceneAsync(modelnames, poses, [state, index](AsyncVerdict verdict){
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->verdicts.push_back(std::make_pair(index, verdict));
+        state->finished.notify_one();
+      }, -index);  //higher ranked candidates go first
+      if (ticket == 0){  //bad candidate, already reported
+        continue;
+      }
+      inFlight[index] = ticket;
+      candidates[index] = poses;
+    }
+    if (inFlight.empty()){
+      break;
+    }
+
+    //wait for verdicts
+    vector< std::pair<int,AsyncVerdict> > verdicts;
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->finished.wait(lock, [&state]{ return !state->verdicts.empty(); });
+      verdicts.swap(state->verdicts);
+    }
+    for (int i = 0; i < verdicts.size(); i++){
+      int index = verdicts[i].first;
+      inFlight.erase(index);
+      if (verdicts[i].second.valid && !verdicts[i].second.cancelled){
+        valid.insert(index);
+      } else {
+        candidates.erase(index);
+      }
+    }
+
+    //once k are valid, candidates ranked below the k-th valid one can't change the answer
+    if (valid.size() >= k && k > 0){
+      int last = *std::next(valid.begin(), k-1);
+      for (auto f = inFlight.begin(); f != inFlight.end(); ++f){
+        if (f->first > last){
+          cancelScene(f->second);
+        }
+      }
+    }
+  }
+
+  vector<int> result;
+  for (auto v = valid.begin(); v != valid.end() && result.size() < k; ++v){
+    result.push_back(*v);
+    if (accepted){
+      accepted->push_back(candidates[*v]);
+    }
+  }
+  return result;
+}
+
+
+/* cancels an async scene */
+bool SceneValidator::cancelScene(SceneTicket ticket){
+  return executor ? executor->cancel(ticket) : false;
+}
+
+
+/* stops the async workers, they are made again (with the current models and parameters) by the next isValidSceneAsync() */
+void SceneValidator::stopAsync(bool cancelAll){
+  if (executor){
+    executor->stop(cancelAll);
+    delete executor;
+    executor = 0;
+  }
+}
+
+
+/* Initializes ODE the first time it's called in the process and gets ODE's per thread data ready for the calling thread.
+   dCloseODE() is never called: it would break every other SceneValidator alive in the process, and the OS frees ODE's
+   memory when the process ends */
+static void initODE(){
+  std::call_once(odeInitialized, []{ dInitODE2(0); });
+  dAllocateODEDataForThread(dAllocateMaskAll);  //does nothing if this thread already has it
+}
+
+
+/* makes a SimWorld using ODE as its backend */
+static SimWorld* createWorld(double GRAVITYx, double GRAVITYy, double GRAVITYz, double PLANEa, double PLANEb, double PLANEc, double PLANEd, double DEFAULT_SCALE){
+  SimWorld *w = new SimWorld();
+  w->gravity[0] = GRAVITYx;  w->gravity[1] = GRAVITYy;  w->gravity[2] = GRAVITYz;
+  w->plane[0] = PLANEa;  w->plane[1] = PLANEb;  w->plane[2] = PLANEc;  w->plane[3] = PLANEd;
+  w->backend = new OdeBackend();
+  w->cache.setCapacity(CACHE_SIZE);
+  w->cacheGeneration = paramGeneration;
+  w->reportSteps = 0;
+  w->counter = 0;
+  w->dsSTEP = 100;
+  w->dsTIME = 5.0;
+  w->cancel = 0;
+  w->handleScene = 0;
+  w->stepBudget = 0;
+  w->hasDeadline = false;
+  w->stoppedEarly = false;
+  w->backend->setGravity(GRAVITYx, GRAVITYy, GRAVITYz);
+  w->backend->setGroundPlane(PLANEa, PLANEb, PLANEc, PLANEd);
+  //scale the ALL objects to DEFAULT_SCALE
+  for (int i =0; i < NUM; i++){
+        w->scaling[i] = DEFAULT_SCALE;
+  }
+  return w;
+}
+
+
+/* custom constructor to construct a SceneValidator object */
+SceneValidator::SceneValidator(double GRAVITYx, double GRAVITYy, double GRAVITYz, double PLANEa, double PLANEb, double PLANEc, double PLANEd, double DEFAULT_SCALE){
+  //initialize ODE and the simulation enviornment
+  initODE();
+  executor = 0;
+  sim = createWorld(GRAVITYx, GRAVITYy, GRAVITYz, PLANEa, PLANEb, PLANEc, PLANEd, DEFAULT_SCALE);
+}
+
+
+/* default constructor to construct a SceneValidator object */
+SceneValidator::SceneValidator(){
+  //initialize ODE and the simulation enviornment
+  initODE();
+  executor = 0;
+  sim = createWorld(GRAVITYx, GRAVITYy, GRAVITYz, PLANEa, PLANEb, PLANEc, PLANEd, DEFAULT_SCALE);
+}
+
+/* default destructor to destruct a SceneValidator object */
+SceneValidator::~SceneValidator(){
+  //shut down simulation enviornment
+  stopAsync(true);
+  delete sim->backend;
+  delete sim;
+}
+
+
+/* true if the world already holds exactly these models at these scales */
+static bool holdsModels(SimWorld &w, const vector<string> &modelnames, const vector<string> &filenames, const vector<double> &scales){
+  if (w.modelNames != modelnames || w.modelFiles != filenames){
+    return false;
+  }
+  for (int i = 0; i < scales.size(); i++){
+    if (w.scaling[i] != scales[i]){
+      return false;
+    }
+  }
+  return true;
+}
+
+
+/* makes a pool of validators in the given world */
+ValidatorPool::ValidatorPool(int size, double GRAVITYx, double GRAVITYy, double GRAVITYz, double PLANEa, double PLANEb, double PLANEc, double PLANEd, double DEFAULT_SCALE){
+  scale = DEFAULT_SCALE;
+  for (int i = 0; i < size; i++){
+    validators.push_back(new SceneValidator(GRAVITYx, GRAVITYy, GRAVITYz, PLANEa, PLANEb, PLANEc, PLANEd, DEFAULT_SCALE));
+  }
+  waiting = validators;
+}
+
+
+/* makes a pool of validators in the default world */
+ValidatorPool::ValidatorPool(int size){
+  scale = DEFAULT_SCALE;
+  for (int i = 0; i < size; i++){
+    validators.push_back(new SceneValidator());
+  }
+  waiting = validators;
+}
+
+
+/* deletes the validators which were checked in, ones still checked out are left alone */
+ValidatorPool::~ValidatorPool(){
+  if (waiting.size() != validators.size()){
+    std::cout<<"***ERROR*** in ~ValidatorPool(). "<<validators.size() - waiting.size()<<" validators were never checked in"<<endl;
+  }
+  for (int i = 0; i < waiting.size(); i++){
+    delete waiting[i];
+  }
+}
+
+
+/* takes a validator holding the requested models out of the pool */
+SceneValidator* ValidatorPool::checkout(std::vector<string> modelnames, std::vector<string> filenames, std::vector<double> scales){
+  if (modelnames.size() != filenames.size()){
+    std::cout<<"***ERROR*** in checkout(). The problem is that modelnames is not the same size as filenames"<<endl;
+    return 0;
+  }
+  if (!scales.empty() && scales.size() != modelnames.size()){
+    std::cout<<"***ERROR*** in checkout(). The problem is that scales is not the same size as modelnames"<<endl;
+    return 0;
+  }
+  if (modelnames.size() > NUM){
+    std::cout<<"***ERROR*** in checkout(). At most "<<NUM<<" models can be loaded"<<endl;
+    return 0;
+  }
+  scales.resize(modelnames.size(), scale);
+  for (int i = 0; i < scales.size(); i++){
+    if (scales[i] <= 0) scales[i] = scale;
+  }
+  initODE();  //the validator may be used in a different thread than the one which made it
+
+  SceneValidator *validator;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    returned.wait(lock, [this]{ return !waiting.empty(); });
+    int chosen = waiting.size() - 1;  //if none holds the models already, one without models, so others keep theirs
+    for (int i = 0; i < waiting.size(); i++){
+      if (holdsModels(*waiting[i]->sim, modelnames, filenames, scales)){
+        chosen = i;
+        break;
+      }
+      if (waiting[i]->sim->modelNames.empty()){
+        chosen = i;
+      }
+    }
+    validator = waiting[chosen];
+    waiting.erase(waiting.begin() + chosen);
+  }
+
+  SimWorld &w = *validator->sim;
+  if (!holdsModels(w, modelnames, filenames, scales)){
+    for (int i = 0; i < NUM; i++){
+      w.scaling[i] = i < scales.size() ? scales[i] : scale;
+    }
+    validator->setModels(modelnames, filenames);
+  }
+  return validator;
+}
+
+
+/* cleans a validator up and puts it back in the pool */
+void ValidatorPool::checkin(SceneValidator *validator){
+  if (std::find(validators.begin(), validators.end(), validator) == validators.end()){
+    std::cout<<"***ERROR*** in checkin(). The validator isn't from this pool"<<endl;
+    return;
+  }
+  SimWorld &w = *validator->sim;
+  validator->stopAsync(true);
+  if (!dynamic_cast<OdeBackend*>(w.backend)){  //setBackend() was used, go back to the default
+    validator->setBackend(new OdeBackend());
+  }
+  validator->clearSupportSurface();
+  w.cache.clear();
+  w.cacheGeneration = paramGeneration;
+  w.committed.clear();
+  w.symmetryAxes.clear();
+  w.preClassifier = PreClassifier();
+  w.stats = SimulationStats();
+  w.cascade = CascadeStats();
+  w.components.clear();
+  w.report = FailureReport();
+  w.reportNames.clear();
+  w.reportBodies.clear();
+  w.cancel = 0;
+  w.stepBudget = 0;
+  w.hasDeadline = false;
+  w.stoppedEarly = false;
+  for (int i = 0; i < w.numModels; i++){  //wake up anything commitScene() put to sleep
+    w.backend->setEnabled(w.obj[i].body, true);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  waiting.push_back(validator);
+  returned.notify_one();
+}
+
+
+/* number of validators not checked out */
+int ValidatorPool::idle(){
+  std::lock_guard<std::mutex> lock(mutex);
+  return waiting.size();
+}
+
+
+/* the pool shared by the whole process */
+ValidatorPool& ValidatorPool::process(){
+  static ValidatorPool pool(POOL_SIZE);
+  return pool;
+}
@@ -10,18 +10,121 @@
 
 #include <stdio.h>
 #include <iostream>
+#include <vector>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
-#include <ode/ode.h>
+#include "physicsBackend.h"
 #ifndef SCENEVALIDATOR_H
 #define SCENEVALIDATOR_H
 
 
+/* What the simulation cost during one isValidScene() call. With ADAPTIVE on, the timestep and solver iterations change
+   from step to step, so the min/max values show how far the schedule moved */
+struct SimulationStats {
+    int    steps = 0;                 //number of simulation steps taken
+    double simulatedTime = 0;         //sum of all timesteps
+    double minTimestep = 1e9;         //smallest timestep used
+    double maxTimestep = 0;           //largest timestep used
+    int    minIterations = 1000000;   //fewest QuickStep solver iterations used in a step
+    int    maxIterations = 0;         //most QuickStep solver iterations used in a step
+    long   totalIterations = 0;       //solver iterations summed over all steps
+    bool   analytic = false;          //true when ANALYTIC decided the scene without simulating it
+    int    shortcutObjects = 0;       //objects SUPPORT_SHORTCUT decided without simulating them
+    bool   cached = false;            //true when the verdict came from the verdict cache (CACHE_SIZE > 0)
+    bool   preclassified = false;     //true when the pre-classifier decided the scene (PRECLASSIFIER = true)
+};
+
+
+struct SimWorld;  //this validator's bodies and simulation state, defined in sceneValidator.cpp
+
+
+/* How many scenes each CASCADE tier decided since the SceneValidator was made */
+struct CascadeStats {
+    long box = 0;                     //decided with oriented bounding boxes
+    long hull = 0;                    //decided with convex hulls
+    long trimesh = 0;                 //needed the full trimesh
+};
+
+
+/* Counters of the verdict cache (CACHE_SIZE > 0). Scenes and COMPONENTS groups share the cache */
+struct CacheStats {
+    long hits = 0;
+    long misses = 0;
+    int  size = 0;                    //verdicts currently kept
+};
+
+
+/* A group of objects which COMPONENTS checked on its own */
+struct ComponentVerdict {
+    std::vector<int> objects;         //indices into modelnames
+    bool checked = false;             //false if COMPONENT_FAIL_FAST stopped before this group
+    bool valid = false;
+    bool cached = false;              //the verdict came from the cache
+};
+
+
+/* What happened to one object in the last check, see getFailureReport() */
+struct ObjectReport {
+    double displacement = 0;          //how far it moved (largest change of x, y or z, like THRESHOLD) when the check ended
+    bool   failed = false;            //moved more than THRESHOLD, or was found to fall without simulating it
+    std::vector<int> restsOn;         //objects (indices into modelnames) it rests on, -1 is the ground or support surface
+};
+
+
+/* Which objects made a scene invalid and the support graph of the scene */
+struct FailureReport {
+    int culprit = -1;                 //first object found to be unstable (index into modelnames), -1 if none was
+    std::vector<ObjectReport> objects;  //one per model name, empty when the verdict came from the cache
+};
+
+
+/* One object of a scene for the handle version of isValidScene() */
+struct ModelPose {
+    int    handle;                    //from setModels()
+    double position[3];               //x, y, z
+    double quaternion[4];             //w, x, y, z, doesn't have to be normalised
+};
+
+
+/* How much a call may spend, 0 means no limit */
+struct SceneBudget {
+    double milliseconds = 0;          //wall clock time
+    int    steps = 0;                 //simulation steps
+};
+
+
+/* Verdict of a call with a SceneBudget */
+struct SceneVerdict {
+    int    verdict = -1;              //1 valid, 0 invalid, -1 undecided (the budget ran out first)
+    double maxDisplacement = 0;       //furthest any object had moved (largest change of x, y or z) when the call ended
+    int    steps = 0;                 //simulation steps taken
+    bool   outOfBudget = false;       //the budget ran out. The verdict is still 0 if an object had already moved more than THRESHOLD
+};
+
+
+/* Verdict of isValidSceneAsync() */
+struct AsyncVerdict {
+    bool valid = false;
+    bool cancelled = false;           //cancelScene() stopped it before it finished, valid is false then
+    bool undecided = false;           //a batch budget ran out before it was decided, see isValidScenesWithin()
+    double maxDisplacement = 0;       //see SceneVerdict
+};
+
+typedef long SceneTicket;             //identifies an async scene for cancelScene(), 0 is never used
+struct AsyncExecutor;                 //the worker threads behind isValidSceneAsync(), defined in sceneValidator.cpp
+
 
 class SceneValidator{
+    friend struct AsyncExecutor;
+    friend class ValidatorPool;
     private:
-     dThreadingThreadPoolID pool;           //used for ODE's threating functions
-     dThreadingImplementationID threading;  //used for ODE's threating functions
+     SimWorld *sim;                         //the world this validator simulates in
+     AsyncExecutor *executor;               //made by the first isValidSceneAsync()
+     void stopAsync(bool cancelAll);        //stops the async workers, finishing or cancelling their scenes
         
     public:
 	SceneValidator(double GRAVITYx, double GRAVITYy, double GRAVITYz, double PLANEa, double PLANEb, double PLANEc, double PLANEd, double DEFAULT_SCALE);  //custom constructor
@@ -38,15 +141,179 @@ class SceneValidator{
 	bool setCamera(float x, float y, float z, float h, float p, float r);
 
         /*Given model names and their filepaths, set the model data to be ready for simulation
-          in isValidScene. Files should be in .obj format. */ 
-        void setModels(std::vector<std::string> modelnames, std::vector<std::string> filepath);
+          in isValidScene. Files should be in .obj format. Returns an integer handle for each model, for the
+          allocation free isValidScene() */ 
+        std::vector<int> setModels(std::vector<std::string> modelnames, std::vector<std::string> filepath);
+
+        /* Writes the loaded models, already scaled and prepared for simulation, to a model store (a file ending in .svstore,
+           see modelStore.h). A model store can be given to setModels() in place of .obj files, then it is mapped read-only
+           and the trimeshes point into it, so every validator and process using it shares one copy of the geometry.
+           The models keep the scale they were stored with, setScale() doesn't change them */
+        bool saveModelStore(std::string filename);
+
+        /* Returns the handle setModels() gave modelname, -1 if it wasn't loaded */
+        int getModelHandle(std::string modelname);
 
         /*Given a list of objects and a list of the 6 DoF pose for each object, check if a scene is 
          physically valid  */ 
         bool isValidScene(std::vector<std::string> modelnames, std::vector<Eigen::Affine3d> model_poses);
+
+        /* Queues a scene to be checked by ASYNC_THREADS worker threads, each with its own world, and returns right away (or
+           waits while ASYNC_QUEUE scenes are already queued). Higher priorities are checked first. The future gets the verdict,
+           ticket (if given) gets the ticket to cancel it with. Don't change parameters with setParams() while scenes are queued,
+           the functions which change models or the support surface wait for the queued scenes to finish first */
+        std::future<AsyncVerdict> isValidSceneAsync(std::vector<std::string> modelnames, std::vector<Eigen::Affine3d> model_poses,
+                                                    int priority = 0, SceneTicket *ticket = 0);
+
+        /* Same as above, but done is called with the verdict (on a worker thread) and the ticket is returned, 0 for bad arguments */
+        SceneTicket isValidSceneAsync(std::vector<std::string> modelnames, std::vector<Eigen::Affine3d> model_poses,
+                                      std::function<void(AsyncVerdict)> done, int priority = 0);
+
+        /* Cancels a queued scene, or stops a running one at its next simulation step. Its verdict says cancelled.
+           Returns false if the scene had already finished */
+        bool cancelScene(SceneTicket ticket);
+
+        /* Finds the first k valid scenes of a ranked stream of candidates. next fills in the next candidate's poses (one per
+           model name, best candidate first) and returns false when there are no more; it is only called as far as needed.
+           Candidates are checked on the async workers in rank order and the search stops as soon as the k best ranked valid
+           ones are known: lower ranked candidates still running are cancelled at their next simulation step. Returns the
+           ranks (0 is the first candidate) of the valid ones, accepted (if given) gets their poses */
+        std::vector<int> firstValidScenes(std::vector<std::string> modelnames, std::function<bool(std::vector<Eigen::Affine3d>&)> next,
+                                          int k, std::vector< std::vector<Eigen::Affine3d> > *accepted = 0);
+
+        /* isValidScene() for hot loops: count objects given by handle, position and quaternion in one contiguous array. Nothing
+           is copied or looked up by name and after the first call or two it makes no heap allocations (see
+           allocationCheck.cpp). Shortcuts which need names (ANALYTIC, SUPPORT_SHORTCUT, CASCADE, COMPONENTS, CACHE_SIZE,
+           PRECLASSIFIER) fall back to the general version */
+        bool isValidScene(const ModelPose *poses, int count);
+
+        /* isValidScene() which stops when budget runs out (checked between simulation steps) and then answers undecided,
+           or invalid if an object has already moved more than THRESHOLD. For control loops with a deadline */
+        SceneVerdict isValidScene(std::vector<std::string> modelnames, std::vector<Eigen::Affine3d> model_poses, SceneBudget budget);
+
+        /* Checks candidates (one pose per model name each, best first) on the async workers with one budget for the whole batch:
+           all of them have to be done budget.milliseconds after the call and each may take budget.steps steps. The best
+           candidates are started first, so the time goes to them, and whatever the deadline cuts off is undecided */
+        std::vector<SceneVerdict> isValidScenesWithin(std::vector<std::string> modelnames, std::vector< std::vector<Eigen::Affine3d> > candidates,
+                                                      SceneBudget budget);
+
+        /* Checks several pose hypotheses of the same models in one world, hypotheses[h] has one pose per model name. The hypotheses
+           never touch each other, each one gets its own verdict and a hypothesis stops being simulated as soon as it fails.
+           Much faster than calling isValidScene() for each hypothesis when there are many of them */
+        std::vector<bool> isValidScenes(std::vector<std::string> modelnames, std::vector< std::vector<Eigen::Affine3d> > hypotheses);
+
+        /* Validates a scene like isValidScene() and, if it is valid, commits it: the poses where its objects settled are kept
+           and isValidWithCommitted() starts from them. The scene is always simulated, the cache, the pre-classifier, ANALYTIC,
+           SUPPORT_SHORTCUT and CASCADE are skipped. Loaded models which aren't in modelnames are left out of the world */
+        bool commitScene(std::vector<std::string> modelnames, std::vector<Eigen::Affine3d> model_poses);
+
+        /* Checks the committed scene plus one more object at pose. The committed objects start asleep at their settled poses so
+           only the new object can disturb them, which makes a search like build_tower cost about one object per check.
+           With commit = true a valid result adds the object (and everyone's new settled poses) to the committed scene */
+        bool isValidWithCommitted(std::string modelname, Eigen::Affine3d pose, bool commit = false);
+
+        /* Simulates the scene until it comes to rest instead of judging it. settled_poses gets every object's final pose and
+           displacements how far its center of mass moved from model_poses, so a nearly right hypothesis can be used in its settled
+           form. Returns false if the scene was still moving after SETTLE_STEPS steps. See SETTLE_SPEED in sceneValidator.cpp */
+        bool settleScene(std::vector<std::string> modelnames, std::vector<Eigen::Affine3d> model_poses,
+                         std::vector<Eigen::Affine3d> &settled_poses, std::vector<double> &displacements);
+
+        /* Forgets the committed scene */
+        void clearCommitted();
+
+        /* Lowers modelname, at the x, y and orientation of pose, onto the committed scene (or the ground) until it touches,
+           sets pose to that placement and checks it with one isValidWithCommitted(). Replaces sweeping the height and calling
+           isValidScene() at every step. PLACEMENT_BISECT finds the height with the physics backend's collision detection
+           instead of the trimeshes, see sceneValidator.cpp. Returns false if the object isn't stable there or has nothing
+           to rest on. With commit = true a stable placement joins the committed scene */
+        bool findPlacement(std::string modelname, Eigen::Affine3d &pose, bool commit = false);
+
+        /* Returns how many steps, how much simulated time and how many solver iterations the last isValidScene() or isValidScenes() call used */
+        SimulationStats getSimulationStats();
+
+        /* Returns which objects failed in the last isValidScene() or isValidWithCommitted(), how far every object moved and what
+           rests on what (from the contacts during the first check, STEP1). A search can re-sample just the culprit and the
+           objects which rest on it, directly or through others, instead of the whole scene */
+        FailureReport getFailureReport();
+
+        /* Returns the groups of objects the last isValidScene() checked on their own and their verdicts (COMPONENTS = true).
+           Objects decided by SUPPORT_SHORTCUT are not in any group */
+        std::vector<ComponentVerdict> getComponentVerdicts();
+
+        /* Declares that turning a model about axis (in the model's .obj frame, through its center of mass) doesn't change it,
+           e.g. the upright axis of a bowl or a glass. Hypotheses which only differ by such a turn then share a cached verdict.
+           A zero axis removes the symmetry */
+        bool setSymmetryAxis(std::string model, Eigen::Vector3d axis);
+
+        /* Returns the cheap geometric features the pre-classifier judges a scene by (PRECLASSIFIER_FEATURES of them, listed in
+           sceneValidator.cpp). Used to train a PreClassifier from logged scenes, see trainPreClassifier.cpp */
+        std::vector<double> getSceneFeatures(std::vector<std::string> modelnames, std::vector<Eigen::Affine3d> model_poses);
+
+        /* Loads a PreClassifier saved by trainPreClassifier. With PRECLASSIFIER on, scenes it is sure about are decided
+           without simulating them and the rest are simulated as usual */
+        bool loadPreClassifier(std::string filename);
+
+        /* Returns the verdict cache's hit and miss counters */
+        CacheStats getCacheStats();
+
+        /* Returns how many scenes each CASCADE tier decided */
+        CascadeStats getCascadeStats();
+
+        /* Replaces the ground plane with a heightfield, e.g. a depth image re-projected into the world frame. heights holds
+           depthSamples rows of widthSamples values, width and depth are the grid's size in world units and pose places the grid's
+           center. Columns run along +x and rows along -y of the pose, like an image seen from above. */
+        bool setSupportSurface(const std::vector<double> &heights, int widthSamples, int depthSamples, double width, double depth, Eigen::Affine3d pose);
+
+        /* Cheaply refreshes the heights of the surface from setSupportSurface() in place. heights must be the same size as before */
+        bool updateSupportSurface(const std::vector<double> &heights);
+
+        /* Removes the heightfield and goes back to the ground plane */
+        void clearSupportSurface();
+
+        /* Replaces the physics engine (OdeBackend by default). The SceneValidator takes ownership of backend and deletes it.
+           Models already loaded with setModels() are rebuilt in the new backend, a support surface has to be set again */
+        void setBackend(PhysicsBackend *backend);
        
 };
 
+
+#define POOL_SIZE 4  // validators in the process wide pool, see ValidatorPool::process()
+
+
+/* SceneValidators made ahead of time and reused. Making a SceneValidator creates an ODE world and its thread pool and
+   loading models builds their trimeshes, so a program which needs validators one after another (like build_tower) should
+   check them out of a pool instead. A validator comes back clean: no committed scene, support surface, cached verdicts,
+   symmetry axes or pre-classifier, holding just the requested models. One which already holds them is preferred, then
+   the models don't have to be loaded again. Parameters set with setParams() are shared by every SceneValidator anyway */
+class ValidatorPool{
+    public:
+        /* makes size validators right away, in a world like SceneValidator's custom constructor makes */
+        ValidatorPool(int size, double GRAVITYx, double GRAVITYy, double GRAVITYz, double PLANEa, double PLANEb, double PLANEc, double PLANEd, double DEFAULT_SCALE);
+        ValidatorPool(int size);  //validators in the default world
+        ~ValidatorPool();         //deletes the validators, they must all have been checked in
+
+        /* Takes a validator out of the pool, holding modelnames loaded from filepaths, scaled by scales (one per model, the
+           pool's DEFAULT_SCALE if empty or for scales <= 0). Waits until one is checked in if they are all out. Give it back with checkin() */
+        SceneValidator* checkout(std::vector<std::string> modelnames, std::vector<std::string> filepaths,
+                                 std::vector<double> scales = std::vector<double>());
+
+        /* Gives a validator back to the pool, which cleans it up for the next checkout() */
+        void checkin(SceneValidator *validator);
+
+        /* Number of validators waiting in the pool */
+        int idle();
+
+        /* The pool shared by the whole process, made with POOL_SIZE default validators the first time it's used */
+        static ValidatorPool& process();
+
+    private:
+        std::vector<SceneValidator*> validators;  //every validator of the pool
+        std::vector<SceneValidator*> waiting;     //the ones not checked out
+        std::mutex mutex;
+        std::condition_variable returned;         //a validator was checked in
+        double scale;                             //DEFAULT_SCALE of the validators
+};
+
 #endif
 
 
@@ -0,0 +1,396 @@
+/****************************************************/
+//Description:  Worker processes checking scenes, see shardedValidator.h.  Each worker has a ShardMemory mapped before
+//              it was forked: the dispatcher writes scenes into its ring and posts queued, the worker checks them in
+//              order, writes each verdict into the verdict ring, advances done and posts the semaphore every worker shares
+//              with the dispatcher.  A worker never has more than SHARD_RING scenes, so neither ring can overflow.
+//              The workers are children of a spawner process which the constructor forks while the dispatcher has one
+//              thread: the dispatcher sends it a worker number over a socket, it forks the worker and sends back its
+//              process id, and when a worker exits it stores the exit in that worker's ShardMemory.
+/****************************************************/
+
+#include "shardedValidator.h"
+#include <deque>                  //used for the scenes waiting to be sent
+#include <new>                    //used to construct ShardMemory in the shared memory
+#include <algorithm>              //used for copy and fill
+#include <atomic>                 //used for the counters shared with the workers
+#include <iostream>               //used for printing errors
+#include <errno.h>                //used to retry interrupted waits
+#include <time.h>                 //used for the wait timeout
+#include <signal.h>               //used to kill workers which don't stop
+#include <unistd.h>               //used for fork
+#include <poll.h>                 //used by the spawner to wait for requests
+#include <sys/socket.h>           //used to talk to the spawner
+#include <semaphore.h>            //used to wake the workers and the dispatcher
+#include <sys/mman.h>             //used for the shared memory
+#include <sys/wait.h>             //used to reap dead workers
+#include <sys/prctl.h>            //used so workers die with the dispatcher
+
+using namespace std;
+
+#define SHARD_POLL 20             // milliseconds the dispatcher waits for a verdict before checking for dead workers
+
+
+/* one scene in a worker's ring */
+struct ShardScene {
+  int count;
+  ModelPose poses[SHARD_MAX_OBJECTS];
+};
+
+/* the memory one worker shares with the dispatcher */
+struct ShardMemory {
+  sem_t queued;                        //posted for every scene written into scenes
+  std::atomic<uint32_t> done;          //verdicts written by the worker
+  std::atomic<uint32_t> taken;         //scenes the worker started checking
+  std::atomic<pid_t> exited;           //the worker's process id, stored by the spawner once it has exited
+  int status;                          //how it exited, from waitpid()
+  std::atomic<bool> quit;              //the worker exits when it sees this
+  uint32_t sent;                       //scenes written by the dispatcher, only it uses these two
+  uint32_t received;                   //verdicts read by the dispatcher
+  ShardScene scenes[SHARD_RING];
+  int verdicts[SHARD_RING];
+};
+
+static sem_t *answered = 0;            //posted by every worker for every verdict, shared by all ShardedValidators
+
+
+/* waits for a semaphore, milliseconds < 0 waits forever. Returns false on timeout */
+static bool waitFor(sem_t *semaphore, int milliseconds){
+  if (milliseconds < 0){
+    while (sem_wait(semaphore) < 0 && errno == EINTR);
+    return true;
+  }
+  timespec until;
+  clock_gettime(CLOCK_REALTIME, &until);
+  until.tv_nsec += milliseconds * 1000000L;
+  until.tv_sec += until.tv_nsec / 1000000000L;
+  until.tv_nsec %= 1000000000L;
+  int result;
+  while ((result = sem_timedwait(semaphore, &until)) < 0 && errno == EINTR);
+  return result == 0;
+}
+
+
+/* what a worker process does until it is told to quit */
+static void workerMain(ShardMemory *shard, const vector<string> &names, const vector<string> &files, const vector<double> &scales,
+                       pid_t parent){
+  prctl(PR_SET_PDEATHSIG, SIGKILL);  //don't outlive the spawner
+  if (getppid() != parent){
+    _exit(0);
+  }
+  SceneValidator *validator = new SceneValidator();
+  for (int i = 0; i < scales.size(); i++){
+    if (scales[i] > 0) validator->setScale(i, scales[i]);
+  }
+  validator->setModels(names, files);
+  uint32_t next = 0;
+  while (true){
+    waitFor(&shard->queued, -1);
+    if (shard->quit.load()){
+      break;
+    }
+    ShardScene &scene = shard->scenes[next % SHARD_RING];
+    shard->taken.store(next + 1);
+    shard->verdicts[next % SHARD_RING] = validator->isValidScene(scene.poses, scene.count);
+    next++;
+    shard->done.store(next);
+    sem_post(answered);
+  }
+  delete validator;
+  _exit(0);  //not exit(), the dispatcher's static objects belong to the dispatcher
+}
+
+
+/* what the spawner process does until the dispatcher closes its socket: forks the workers it asks for and reaps them */
+static void spawnerMain(int socket, const vector<ShardMemory*> &shards, const vector<string> &names, const vector<string> &files,
+                        const vector<double> &scales, pid_t parent){
+  prctl(PR_SET_PDEATHSIG, SIGKILL);  //don't outlive the dispatcher
+  if (getppid() != parent){
+    _exit(0);
+  }
+  pid_t self = getpid();
+  vector<pid_t> workers(shards.size(), -1);
+  while (true){
+    int status;
+    pid_t process;
+    while ((process = waitpid(-1, &status, WNOHANG)) > 0){
+      for (int i = 0; i < workers.size(); i++){
+        if (workers[i] == process){
+          shards[i]->status = status;
+          shards[i]->exited.store(process);
+          workers[i] = -1;
+        }
+      }
+    }
+    pollfd request = {socket, POLLIN, 0};
+    if (poll(&request, 1, SHARD_POLL) <= 0){
+      continue;
+    }
+    int i;
+    if (recv(socket, &i, sizeof(i), MSG_WAITALL) != sizeof(i) || i < 0 || i >= shards.size()){
+      break;  //the dispatcher is gone
+    }
+    process = fork();
+    if (process == 0){
+      close(socket);
+      workerMain(shards[i], names, files, scales, self);
+    }
+    if (process > 0){
+      workers[i] = process;
+    }
+    send(socket, &process, sizeof(process), MSG_NOSIGNAL);
+  }
+  for (int i = 0; i < workers.size(); i++){
+    if (workers[i] > 0){
+      kill(workers[i], SIGKILL);
+      waitpid(workers[i], 0, 0);
+    }
+  }
+  _exit(0);
+}
+
+
+ShardedValidator::ShardedValidator(int workers, vector<string> modelnames, vector<string> filepaths, vector<double> scales)
+  : names(modelnames), files(filepaths), scales(scales), spawner(-1), spawnerSocket(-1), restarts(0){
+  if (modelnames.size() != filepaths.size()){
+    std::cout<<"***ERROR*** in ShardedValidator(). The problem is that modelnames is not the same size as filepaths"<<endl;
+    workers = 0;
+  }
+  if (!answered){
+    answered = (sem_t*)mmap(0, sizeof(sem_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    sem_init(answered, 1, 0);
+  }
+  for (int i = 0; i < workers; i++){
+    void *memory = mmap(0, sizeof(ShardMemory), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED){
+      std::cout<<"***ERROR*** in ShardedValidator(). Couldn't map shared memory for worker "<<i<<endl;
+      break;
+    }
+    shards.push_back(new (memory) ShardMemory());
+    sem_init(&shards[i]->queued, 1, 0);
+    processes.push_back(-1);
+    workerRestarts.push_back(0);
+    givenUp.push_back(false);
+  }
+  if (shards.empty()){
+    return;
+  }
+
+  //the spawner gets every ShardMemory, so they are all mapped before it is forked
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) < 0){
+    std::cout<<"***ERROR*** in ShardedValidator(). Couldn't make the spawner's socket"<<endl;
+  } else {
+    pid_t parent = getpid();
+    spawner = fork();
+    if (spawner == 0){
+      close(sockets[0]);
+      spawnerMain(sockets[1], shards, names, files, scales, parent);
+    }
+    close(sockets[1]);
+    if (spawner < 0){
+      std::cout<<"***ERROR*** in ShardedValidator(). Couldn't fork the spawner"<<endl;
+      close(sockets[0]);
+    } else {
+      spawnerSocket = sockets[0];
+    }
+  }
+  for (int i = 0; i < shards.size(); i++){
+    startWorker(i);
+  }
+}
+
+
+ShardedValidator::~ShardedValidator(){
+  for (int i = 0; i < shards.size(); i++){
+    shards[i]->quit.store(true);
+    sem_post(&shards[i]->queued);
+  }
+  for (int i = 0; i < shards.size(); i++){
+    int waited = 0;
+    while (processes[i] > 0 && shards[i]->exited.load() != processes[i]){
+      if (waited++ == 100){  //a second is long enough to finish a scene
+        kill(processes[i], SIGKILL);
+        break;
+      }
+      usleep(10000);
+    }
+  }
+  if (spawner > 0){
+    close(spawnerSocket);       //the spawner kills and reaps the workers still there, then exits
+    waitpid(spawner, 0, 0);
+  }
+  for (int i = 0; i < shards.size(); i++){
+    sem_destroy(&shards[i]->queued);
+    shards[i]->~ShardMemory();
+    munmap(shards[i], sizeof(ShardMemory));
+  }
+}
+
+
+/* has the spawner fork worker i with empty rings */
+void ShardedValidator::startWorker(int i){
+  ShardMemory *shard = shards[i];
+  sem_destroy(&shard->queued);
+  sem_init(&shard->queued, 1, 0);
+  shard->done.store(0);
+  shard->taken.store(0);
+  shard->exited.store(0);
+  shard->quit.store(false);
+  shard->sent = 0;
+  shard->received = 0;
+  pid_t process = -1;
+  if (spawnerSocket < 0 || send(spawnerSocket, &i, sizeof(i), MSG_NOSIGNAL) != sizeof(i) ||
+      recv(spawnerSocket, &process, sizeof(process), MSG_WAITALL) != sizeof(process)){
+    process = -1;
+  }
+  if (process < 0){
+    std::cout<<"***ERROR*** in ShardedValidator. Couldn't fork worker "<<i<<endl;
+  }
+  processes[i] = process;
+}
+
+
+/* true if worker i has exited, was killed or couldn't be forked */
+bool ShardedValidator::workerDied(int i){
+  if (processes[i] <= 0){
+    return true;
+  }
+  if (shards[i]->exited.load() != processes[i]){
+    return false;
+  }
+  std::cout<<"***ERROR*** in ShardedValidator. Worker "<<i<<" died";
+  if (WIFSIGNALED(shards[i]->status)){
+    std::cout<<" (signal "<<WTERMSIG(shards[i]->status)<<")";
+  }
+  std::cout<<endl;
+  processes[i] = -1;
+  return true;
+}
+
+
+/* forks worker i again, or gives it up once it died SHARD_MAX_RESTARTS times in a row without a verdict */
+void ShardedValidator::restartWorker(int i){
+  if (workerRestarts[i] >= SHARD_MAX_RESTARTS){
+    std::cout<<"***ERROR*** in ShardedValidator. Worker "<<i<<" was forked again "<<SHARD_MAX_RESTARTS
+             <<" times without checking a scene, giving it up"<<endl;
+    givenUp[i] = true;
+    return;
+  }
+  std::cout<<"Forking worker "<<i<<" again"<<endl;
+  workerRestarts[i]++;
+  restarts++;
+  startWorker(i);
+}
+
+
+int ShardedValidator::getModelHandle(string modelname){
+  for (int i = 0; i < names.size(); i++){
+    if (names[i] == modelname){
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+vector<int> ShardedValidator::isValidScenes(const vector< vector<ModelPose> > &scenes){
+  vector<int> verdicts(scenes.size(), -1);
+  deque<int> waiting;                       //scenes not sent yet
+  vector< deque<int> > inFlight(shards.size());  //scenes sent to each worker, in the order it checks them
+  int finished = 0;
+
+  //a scene the worker would refuse gets -1 right away
+  vector<bool> used(names.size());
+  for (int s = 0; s < scenes.size(); s++){
+    bool good = !scenes[s].empty() && scenes[s].size() <= SHARD_MAX_OBJECTS;
+    std::fill(used.begin(), used.end(), false);
+    for (int k = 0; k < scenes[s].size() && good; k++){
+      int handle = scenes[s][k].handle;
+      good = handle >= 0 && handle < names.size() && !used[handle];
+      if (good) used[handle] = true;
+    }
+    if (good){
+      waiting.push_back(s);
+    } else {
+      finished++;
+    }
+  }
+  if (shards.empty()){
+    return verdicts;
+  }
+
+  while (finished < scenes.size()){
+    //fill every worker's ring
+    bool working = false;
+    for (int i = 0; i < shards.size(); i++){
+      if (givenUp[i]){
+        continue;
+      }
+      working = true;
+      ShardMemory *shard = shards[i];
+      while (!waiting.empty() && inFlight[i].size() < SHARD_RING){
+        int s = waiting.front();
+        waiting.pop_front();
+        ShardScene &scene = shard->scenes[shard->sent % SHARD_RING];
+        scene.count = scenes[s].size();
+        std::copy(scenes[s].begin(), scenes[s].end(), scene.poses);
+        shard->sent++;
+        inFlight[i].push_back(s);
+        sem_post(&shard->queued);
+      }
+    }
+    if (!working){
+      //every worker was given up, nothing is in flight and the waiting scenes keep their -1
+      finished += waiting.size();
+      waiting.clear();
+      break;
+    }
+
+    waitFor(answered, SHARD_POLL);
+
+    for (int i = 0; i < shards.size(); i++){
+      if (givenUp[i]){
+        continue;
+      }
+      ShardMemory *shard = shards[i];
+      bool died = workerDied(i);  //checked first, so verdicts it wrote before dying are still read below
+      uint32_t done = shard->done.load();
+      if (shard->received < done){
+        workerRestarts[i] = 0;
+      }
+      while (shard->received < done){
+        verdicts[inFlight[i].front()] = shard->verdicts[shard->received % SHARD_RING];
+        inFlight[i].pop_front();
+        shard->received++;
+        finished++;
+      }
+      if (died){
+        //a scene it had taken was being simulated when it died, the others go to the front of the queue again
+        if (!inFlight[i].empty() && shard->taken.load() > shard->received){
+          inFlight[i].pop_front();
+          finished++;
+        }
+        waiting.insert(waiting.begin(), inFlight[i].begin(), inFlight[i].end());
+        inFlight[i].clear();
+        restartWorker(i);
+      }
+    }
+  }
+  return verdicts;
+}
+
+
+int ShardedValidator::isValidScene(const ModelPose *poses, int count){
+  vector< vector<ModelPose> > scenes(1, vector<ModelPose>(poses, poses + std::max(count, 0)));
+  return isValidScenes(scenes)[0];
+}
+
+
+pid_t ShardedValidator::getWorkerProcess(int i){
+  return i >= 0 && i < processes.size() ? processes[i] : -1;
+}
+
+
+int ShardedValidator::getRestarts(){
+  return restarts;
+}
@@ -0,0 +1,68 @@
+/****************************************************/
+//Description:  Checks scenes in worker processes instead of threads.  ODE keeps some state per process (dInitODE2()) and
+//              per thread (dAllocateODEDataForThread()) and not every ODE build is safe to use from many threads at once,
+//              so ShardedValidator forks workers which each own a SceneValidator and the models, and hands them scenes
+//              through ring buffers in shared memory.  A worker which crashes takes only the scene it was simulating with
+//              it: that scene gets a verdict of -1, the worker is forked again and the rest carry on.  Workers are forked
+//              by a spawner process forked once in the constructor, so a restart never forks the dispatcher's threads.
+/****************************************************/
+
+#include <vector>
+#include <string>
+#include <sys/types.h>
+#include "sceneValidator.h"
+#ifndef SHARDEDVALIDATOR_H
+#define SHARDEDVALIDATOR_H
+
+#define SHARD_RING 16            // scenes each worker can have queued
+#define SHARD_MAX_OBJECTS 200    // most objects in a scene
+#define SHARD_MAX_RESTARTS 3     // times in a row a worker is forked again without checking a scene before it is given up
+
+
+struct ShardMemory;  //one worker's ring buffers, defined in shardedValidator.cpp
+
+
+class ShardedValidator{
+    public:
+        /* Forks a spawner process which forks workers processes, each loading modelnames from filepaths (scales like ValidatorPool::checkout()). Parameters
+           set with setParams() before this are the workers' parameters, later changes don't reach them. Make it before
+           starting other threads, fork() only copies the calling thread */
+        ShardedValidator(int workers, std::vector<std::string> modelnames, std::vector<std::string> filepaths,
+                         std::vector<double> scales = std::vector<double>());
+        ~ShardedValidator();  //stops the workers
+
+        /* Returns the handle of modelname, -1 if it isn't one of the models */
+        int getModelHandle(std::string modelname);
+
+        /* Checks scenes (handles and poses, like SceneValidator's handle isValidScene()) spread over the workers. Returns a
+           verdict per scene: 1 valid, 0 invalid, -1 if the scene was bad, its worker crashed while checking it or every
+           worker was given up */
+        std::vector<int> isValidScenes(const std::vector< std::vector<ModelPose> > &scenes);
+
+        /* Checks one scene on a worker, same verdicts as above */
+        int isValidScene(const ModelPose *poses, int count);
+
+        /* Process id of worker i, e.g. to watch or kill it, -1 once it is given up */
+        pid_t getWorkerProcess(int i);
+
+        /* Workers forked again after they died */
+        int getRestarts();
+
+    private:
+        void startWorker(int i);
+        bool workerDied(int i);
+        void restartWorker(int i);
+
+        std::vector<std::string> names;
+        std::vector<std::string> files;
+        std::vector<double> scales;
+        std::vector<ShardMemory*> shards;     //shared with the workers
+        std::vector<pid_t> processes;
+        std::vector<int> workerRestarts;      //times each worker was forked again since its last verdict
+        std::vector<bool> givenUp;            //workers not forked again after SHARD_MAX_RESTARTS
+        pid_t spawner;                        //forks the workers
+        int spawnerSocket;                    //worker numbers go to the spawner, process ids come back
+        int restarts;
+};
+
+#endif
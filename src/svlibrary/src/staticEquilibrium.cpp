@@ -0,0 +1,129 @@
+/****************************************************/
+//Description:  Static equilibrium from contact forces, see staticEquilibrium.h.  The non-negative least squares
+//              solver is Lawson and Hanson's active set method.
+/****************************************************/
+
+#include "staticEquilibrium.h"
+#include <map>                    //used to find a body's row from its handle
+#include <cmath>                  //used for sqrt
+#include <algorithm>              //used for min
+#include <Eigen/Dense>            //used for the least squares solves
+
+using namespace std;
+
+
+/* Lawson-Hanson non-negative least squares: minimizes |A x - b| with x >= 0 */
+static Eigen::VectorXd nnls(const Eigen::MatrixXd &A, const Eigen::VectorXd &b){
+  int n = A.cols();
+  Eigen::VectorXd x = Eigen::VectorXd::Zero(n);
+  vector<bool> passive(n, false);   //variables allowed to be > 0
+  const double tol = 1e-10;
+
+  for (int outer = 0; outer < 3*n; outer++){
+    //the variable which would lower the residual the most
+    Eigen::VectorXd w = A.transpose() * (b - A*x);
+    int best = -1;
+    for (int j = 0; j < n; j++){
+      if (!passive[j] && w[j] > tol && (best < 0 || w[j] > w[best])) best = j;
+    }
+    if (best < 0) break;
+    passive[best] = true;
+
+    while (true){
+      //unconstrained least squares over the passive variables
+      vector<int> cols;
+      for (int j = 0; j < n; j++){
+        if (passive[j]) cols.push_back(j);
+      }
+      Eigen::MatrixXd Ap(A.rows(), cols.size());
+      for (int k = 0; k < cols.size(); k++){
+        Ap.col(k) = A.col(cols[k]);
+      }
+      Eigen::VectorXd z = Ap.colPivHouseholderQr().solve(b);
+      Eigen::VectorXd s = Eigen::VectorXd::Zero(n);
+      for (int k = 0; k < cols.size(); k++){
+        s[cols[k]] = z[k];
+      }
+
+      //all positive: take it. Otherwise move towards it until a variable hits 0 and drop that variable
+      double alpha = 2;
+      for (int k = 0; k < cols.size(); k++){
+        int j = cols[k];
+        if (s[j] <= tol){
+          alpha = min(alpha, x[j] / (x[j] - s[j]));
+        }
+      }
+      if (alpha > 1){
+        x = s;
+        break;
+      }
+      x += alpha * (s - x);
+      for (int k = 0; k < cols.size(); k++){
+        int j = cols[k];
+        if (x[j] <= tol){
+          passive[j] = false;
+          x[j] = 0;
+        }
+      }
+    }
+  }
+  return x;
+}
+
+
+vector<double> equilibriumResiduals(const vector<BackendContact> &contacts, const vector<EquilibriumBody> &bodies,
+                                    const double gravity[3], double friction){
+  int numBodies = bodies.size();
+  map<int,int> row;  //handle -> body index
+  for (int i = 0; i < numBodies; i++){
+    row[bodies[i].handle] = i;
+  }
+  Eigen::Vector3d g(gravity[0], gravity[1], gravity[2]);
+  double weight = g.norm();
+  friction = min(friction, 100.0);  //an "infinite" friction makes the pyramid's edges nearly parallel to the surface
+
+  //Each row block is one body: 3 force rows divided by its weight and 3 torque rows divided by weight*radius.
+  //Each column is one edge of one contact's friction pyramid, pushing body1 and pulling body2 the same amount
+  vector<int> used;
+  for (int c = 0; c < contacts.size(); c++){
+    if (row.count(contacts[c].body1) || row.count(contacts[c].body2)) used.push_back(c);
+  }
+  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(6*numBodies, PYRAMID_SIDES*used.size());
+  Eigen::VectorXd b = Eigen::VectorXd::Zero(6*numBodies);
+  for (int i = 0; i < numBodies; i++){
+    b.segment<3>(6*i) = weight > 0 ? Eigen::Vector3d(-g / weight) : Eigen::Vector3d::Zero();  //contact forces have to cancel the weight
+  }
+  for (int u = 0; u < used.size(); u++){
+    const BackendContact &contact = contacts[used[u]];
+    Eigen::Vector3d pos(contact.pos[0], contact.pos[1], contact.pos[2]);
+    Eigen::Vector3d normal(contact.normal[0], contact.normal[1], contact.normal[2]);
+    Eigen::Vector3d t1 = normal.unitOrthogonal();
+    Eigen::Vector3d t2 = normal.cross(t1);
+    for (int k = 0; k < PYRAMID_SIDES; k++){
+      double angle = 2*M_PI*k / PYRAMID_SIDES;
+      Eigen::Vector3d direction = normal + friction*(cos(angle)*t1 + sin(angle)*t2);
+      int col = PYRAMID_SIDES*u + k;
+      for (int side = 0; side < 2; side++){
+        int handle = side == 0 ? contact.body1 : contact.body2;
+        if (!row.count(handle)) continue;
+        const EquilibriumBody &body = bodies[row[handle]];
+        Eigen::Vector3d force = side == 0 ? direction : Eigen::Vector3d(-direction);
+        Eigen::Vector3d arm = pos - Eigen::Vector3d(body.com[0], body.com[1], body.com[2]);
+        double scale = body.mass * weight;
+        int r = 6*row[handle];
+        A.block<3,1>(r, col) = force / scale;
+        A.block<3,1>(r+3, col) = arm.cross(force) / (scale * body.radius);
+      }
+    }
+  }
+
+  Eigen::VectorXd residual = b;
+  if (A.cols() > 0){
+    residual = A*nnls(A, b) - b;
+  }
+  vector<double> result(numBodies);
+  for (int i = 0; i < numBodies; i++){
+    result[i] = residual.segment<6>(6*i).norm();
+  }
+  return result;
+}
@@ -0,0 +1,29 @@
+/****************************************************/
+//Description:  Checks if a scene is in static equilibrium without simulating it.  Given the contacts at the starting
+//              pose, look for contact forces inside the friction cones which cancel gravity and torque on every body.
+//              This is a non-negative least squares problem over a friction pyramid, a body is balanced when the
+//              leftover force and torque of the best solution is (close to) zero.
+/****************************************************/
+
+#include "physicsBackend.h"
+#include <vector>
+#ifndef STATICEQUILIBRIUM_H
+#define STATICEQUILIBRIUM_H
+
+#define PYRAMID_SIDES 4  // number of edges of the linearised friction cone
+
+
+/* a body taking part in the equilibrium check */
+struct EquilibriumBody {
+    int    handle;       //the body's handle in the backend, contacts refer to it
+    double mass;
+    double com[3];       //center of mass in the world
+    double radius;       //rough size of the body, turns torques into forces so they can be compared with the weight
+};
+
+/* Returns, for each body, how much of its weight (and weight*radius of torque) is left unbalanced by the best contact forces.
+   0 means balanced, 1 means nothing holds it up. Contacts with bodies not in the list (and the ground, -1) are fixed supports */
+std::vector<double> equilibriumResiduals(const std::vector<BackendContact> &contacts, const std::vector<EquilibriumBody> &bodies,
+                                         const double gravity[3], double friction);
+
+#endif
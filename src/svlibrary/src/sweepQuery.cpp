@@ -0,0 +1,94 @@
+/****************************************************/
+//Description:  Sweep of points against triangles.  Everything is projected onto the plane across the sweep direction
+//              and the triangles are binned into a uniform grid there, so each point only casts its ray against the
+//              few triangles whose shadow covers it.  Scanned models have a few thousand triangles, so one query takes
+//              a few milliseconds instead of the seconds a brute force points * triangles test would.
+/****************************************************/
+
+#include "sweepQuery.h"
+#include <cmath>                  //used for sqrt and floor
+#include <algorithm>              //used for std::min and std::max
+
+using namespace std;
+
+
+/* Distance along direction from p to triangle (a,b,c), -1 if the ray misses it (Moller-Trumbore) */
+static double rayTriangle(const Eigen::Vector3d &p, const Eigen::Vector3d &direction,
+                          const Eigen::Vector3d &a, const Eigen::Vector3d &b, const Eigen::Vector3d &c){
+  Eigen::Vector3d e1 = b - a, e2 = c - a;
+  Eigen::Vector3d h = direction.cross(e2);
+  double det = e1.dot(h);
+  if (std::abs(det) < 1e-15){  //ray parallel to the triangle
+    return -1;
+  }
+  Eigen::Vector3d s = p - a;
+  double u = s.dot(h) / det;
+  if (u < 0 || u > 1){
+    return -1;
+  }
+  Eigen::Vector3d q = s.cross(e1);
+  double v = direction.dot(q) / det;
+  if (v < 0 || u + v > 1){
+    return -1;
+  }
+  double t = e2.dot(q) / det;
+  return t >= 0 ? t : -1;
+}
+
+
+double sweepDistance(const vector<Eigen::Vector3d> &points, const vector<Eigen::Vector3d> &corners, const Eigen::Vector3d &direction){
+  int numTriangles = corners.size() / 3;
+  if (points.empty() || numTriangles == 0){
+    return -1;
+  }
+
+  //2D coordinates across the sweep direction
+  Eigen::Vector3d u = direction.unitOrthogonal();
+  Eigen::Vector3d v = direction.cross(u);
+  double lo[2] = {1e300, 1e300}, hi[2] = {-1e300, -1e300};
+  for (int i = 0; i < corners.size(); i++){
+    double x = u.dot(corners[i]), y = v.dot(corners[i]);
+    lo[0] = std::min(lo[0], x);  hi[0] = std::max(hi[0], x);
+    lo[1] = std::min(lo[1], y);  hi[1] = std::max(hi[1], y);
+  }
+
+  //about one triangle per cell
+  int cells = std::max(1, (int)std::sqrt((double)numTriangles));
+  double size[2] = {std::max((hi[0]-lo[0]) / cells, 1e-9), std::max((hi[1]-lo[1]) / cells, 1e-9)};
+  vector< vector<int> > grid(cells*cells);
+  for (int t = 0; t < numTriangles; t++){
+    double tlo[2] = {1e300, 1e300}, thi[2] = {-1e300, -1e300};
+    for (int k = 0; k < 3; k++){
+      double x = u.dot(corners[3*t+k]), y = v.dot(corners[3*t+k]);
+      tlo[0] = std::min(tlo[0], x);  thi[0] = std::max(thi[0], x);
+      tlo[1] = std::min(tlo[1], y);  thi[1] = std::max(thi[1], y);
+    }
+    int i0 = std::min(cells-1, (int)((tlo[0]-lo[0]) / size[0])), i1 = std::min(cells-1, (int)((thi[0]-lo[0]) / size[0]));
+    int j0 = std::min(cells-1, (int)((tlo[1]-lo[1]) / size[1])), j1 = std::min(cells-1, (int)((thi[1]-lo[1]) / size[1]));
+    for (int i = i0; i <= i1; i++){
+      for (int j = j0; j <= j1; j++){
+        grid[i*cells + j].push_back(t);
+      }
+    }
+  }
+
+  //cast every point's ray against the triangles in its cell
+  double best = -1;
+  for (int p = 0; p < points.size(); p++){
+    double x = u.dot(points[p]), y = v.dot(points[p]);
+    if (x < lo[0] || x > hi[0] || y < lo[1] || y > hi[1]){  //outside the mesh's shadow
+      continue;
+    }
+    int i = std::min(cells-1, (int)((x-lo[0]) / size[0]));
+    int j = std::min(cells-1, (int)((y-lo[1]) / size[1]));
+    const vector<int> &cell = grid[i*cells + j];
+    for (int k = 0; k < cell.size(); k++){
+      int t = cell[k];
+      double d = rayTriangle(points[p], direction, corners[3*t], corners[3*t+1], corners[3*t+2]);
+      if (d >= 0 && (best < 0 || d < best)){
+        best = d;
+      }
+    }
+  }
+  return best;
+}
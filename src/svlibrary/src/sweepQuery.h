@@ -0,0 +1,16 @@
+/****************************************************/
+//Description:  How far a rigid set of points can slide along a direction before it runs into a triangle mesh.
+//              Used by SceneValidator::findPlacement() to lower an object onto a scene without simulating it.
+/****************************************************/
+
+#include <vector>
+#include <Eigen/Dense>
+#ifndef SWEEPQUERY_H
+#define SWEEPQUERY_H
+
+
+/* Distance every point of points can move along direction (unit length) before the first one hits one of the triangles,
+   given as 3 corners each in corners. Only hits in front of the points count. Returns -1 if no point ever hits a triangle */
+double sweepDistance(const std::vector<Eigen::Vector3d> &points, const std::vector<Eigen::Vector3d> &corners, const Eigen::Vector3d &direction);
+
+#endif
@@ -0,0 +1,130 @@
+/****************************************************/
+//Description:  Client of the validation daemon, see validationClient.h
+/****************************************************/
+
+#include "validationClient.h"
+#include <string.h>               //used for memcpy and strncpy
+#include <unistd.h>               //used for close
+#include <iostream>               //used for printing errors
+#include <sys/socket.h>           //used for the socket
+#include <sys/un.h>               //used for Unix domain socket addresses
+
+using namespace std;
+
+
+ValidationClient::ValidationClient() : fd(-1), nextId(1){
+}
+
+
+ValidationClient::~ValidationClient(){
+  disconnect();
+}
+
+
+bool ValidationClient::connect(string socketPath){
+  disconnect();
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)){
+    cout<<"***ERROR*** in ValidationClient::connect(). The socket path "<<socketPath<<" is too long"<<endl;
+    return false;
+  }
+  strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, (sockaddr*)&address, sizeof(address)) < 0){
+    cout<<"***ERROR*** in ValidationClient::connect(). No daemon is listening at "<<socketPath<<endl;
+    disconnect();
+    return false;
+  }
+
+  //ask for the models so handles can be looked up by name
+  FrameHeader request = {SV_MAGIC, SV_MODELS, 0, 0};
+  FrameHeader reply;
+  if (!writeAll(fd, &request, sizeof(request)) || !readAll(fd, &reply, sizeof(reply)) || reply.magic != SV_MAGIC || reply.type != SV_MODELS){
+    cout<<"***ERROR*** in ValidationClient::connect(). The daemon didn't send its models"<<endl;
+    disconnect();
+    return false;
+  }
+  names.clear();
+  for (int i = 0; i < reply.count; i++){
+    uint32_t length;
+    if (!readAll(fd, &length, 4)){
+      disconnect();
+      return false;
+    }
+    string name(length, ' ');
+    if (length > 0 && !readAll(fd, &name[0], length)){
+      disconnect();
+      return false;
+    }
+    names.push_back(name);
+  }
+  return true;
+}
+
+
+void ValidationClient::disconnect(){
+  if (fd >= 0){
+    close(fd);
+  }
+  fd = -1;
+}
+
+
+vector<string> ValidationClient::getModelNames(){
+  return names;
+}
+
+
+int ValidationClient::getModelHandle(string modelname){
+  for (int i = 0; i < names.size(); i++){
+    if (names[i] == modelname){
+      return i;
+    }
+  }
+  return -1;
+}
+
+
+uint32_t ValidationClient::sendScene(const ModelPose *poses, int count){
+  if (fd < 0 || count < 0 || count > SV_MAX_OBJECTS){
+    return 0;
+  }
+  uint32_t id = nextId++;
+  if (nextId == 0) nextId = 1;  //0 means failure
+  FrameHeader header = {SV_MAGIC, SV_SCENE, id, count};
+  buffer.resize(sizeof(header) + count*POSE_BYTES);
+  memcpy(&buffer[0], &header, sizeof(header));
+  packPoses(poses, count, &buffer[sizeof(header)]);
+  if (!writeAll(fd, &buffer[0], buffer.size())){
+    disconnect();
+    return 0;
+  }
+  return id;
+}
+
+
+int ValidationClient::receiveVerdict(uint32_t &id){
+  FrameHeader reply;
+  if (fd < 0 || !readAll(fd, &reply, sizeof(reply)) || reply.magic != SV_MAGIC || reply.type != SV_SCENE){
+    disconnect();
+    return -1;
+  }
+  id = reply.id;
+  return reply.count;
+}
+
+
+int ValidationClient::isValidScene(const ModelPose *poses, int count){
+  uint32_t sent = sendScene(poses, count);
+  if (sent == 0){
+    return -1;
+  }
+  uint32_t id = 0;
+  int verdict = -1;
+  while (fd >= 0 && id != sent){  //skips verdicts of scenes sent with sendScene() and never received
+    verdict = receiveVerdict(id);
+  }
+  return id == sent ? verdict : -1;
+}
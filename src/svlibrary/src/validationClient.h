@@ -0,0 +1,45 @@
+/****************************************************/
+//Description:  A thin client of the validation daemon (sceneValidatorDaemon).  Processes which link only this, not
+//              ODE, send scenes as (handle, pose) arrays over a Unix domain socket and the daemon, which loaded the
+//              models once for all of them, sends back the verdicts.  One client is one connection and shouldn't be
+//              used by two threads at once, give each thread its own.
+/****************************************************/
+
+#include <string>
+#include <vector>
+#include "validationProtocol.h"
+#ifndef VALIDATIONCLIENT_H
+#define VALIDATIONCLIENT_H
+
+
+class ValidationClient{
+    public:
+        ValidationClient();
+        ~ValidationClient();  //disconnects
+
+        /* Connects to the daemon and asks for its models. Returns false if there's no daemon listening at socketPath */
+        bool connect(std::string socketPath = SV_SOCKET_PATH);
+        void disconnect();
+
+        /* The daemon's models, getModelNames()[handle] is the model with that handle */
+        std::vector<std::string> getModelNames();
+
+        /* Returns the handle of modelname, -1 if the daemon didn't load it */
+        int getModelHandle(std::string modelname);
+
+        /* Checks a scene and waits for the verdict: 1 valid, 0 invalid, -1 if the request was bad or the connection failed */
+        int isValidScene(const ModelPose *poses, int count);
+
+        /* For keeping several scenes in flight: sendScene() returns the id of the request (0 if sending failed) and
+           receiveVerdict() waits for the next verdict, which may be of any scene in flight, and sets id to its request */
+        uint32_t sendScene(const ModelPose *poses, int count);
+        int receiveVerdict(uint32_t &id);
+
+    private:
+        int fd;                               //the socket, -1 when not connected
+        uint32_t nextId;                      //id of the next request
+        std::vector<std::string> names;       //the daemon's models
+        std::vector<char> buffer;             //the frame being sent
+};
+
+#endif
@@ -0,0 +1,68 @@
+/****************************************************/
+//Description:  Framing helpers of the validation daemon's socket, see validationProtocol.h
+/****************************************************/
+
+#include "validationProtocol.h"
+#include <string.h>               //used for memcpy
+#include <errno.h>                //used to retry interrupted calls
+#include <unistd.h>               //used for read and write
+#include <sys/socket.h>           //used for send
+
+using namespace std;
+
+
+bool writeAll(int fd, const void *data, size_t size){
+  const char *p = (const char*)data;
+  while (size > 0){
+    ssize_t n = send(fd, p, size, MSG_NOSIGNAL);  //a client which went away shouldn't kill the daemon with SIGPIPE
+    if (n < 0 && errno == EINTR){
+      continue;
+    }
+    if (n <= 0){
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+
+bool readAll(int fd, void *data, size_t size){
+  char *p = (char*)data;
+  while (size > 0){
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR){
+      continue;
+    }
+    if (n <= 0){
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+
+void packPoses(const ModelPose *poses, int count, char *buffer){
+  for (int i = 0; i < count; i++){
+    int32_t handle = poses[i].handle;
+    memcpy(buffer, &handle, 4);
+    memcpy(buffer + 4, poses[i].position, 3*8);
+    memcpy(buffer + 4 + 3*8, poses[i].quaternion, 4*8);
+    buffer += POSE_BYTES;
+  }
+}
+
+
+void unpackPoses(const char *buffer, int count, ModelPose *poses){
+  for (int i = 0; i < count; i++){
+    int32_t handle;
+    memcpy(&handle, buffer, 4);
+    poses[i].handle = handle;
+    memcpy(poses[i].position, buffer + 4, 3*8);
+    memcpy(poses[i].quaternion, buffer + 4 + 3*8, 4*8);
+    buffer += POSE_BYTES;
+  }
+}
@@ -0,0 +1,41 @@
+/****************************************************/
+//Description:  The framing spoken over the validation daemon's Unix domain socket (see sceneValidatorDaemon.cpp and
+//              validationClient.h).  Both ends are on the same machine, so everything is in the machine's own byte order.
+//              Every frame starts with a FrameHeader.  A scene request is followed by count poses of POSE_BYTES each
+//              (int32 handle, then 3 position and 4 quaternion doubles, packed), a models request by nothing.
+//              The reply to a scene has the verdict in count (1 valid, 0 invalid, -1 bad request) and nothing after it,
+//              the reply to a models request has the number of models in count followed by each name as a uint32
+//              length and its characters, in handle order.
+/****************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sceneValidator.h"
+#ifndef VALIDATIONPROTOCOL_H
+#define VALIDATIONPROTOCOL_H
+
+#define SV_SOCKET_PATH "/tmp/scenevalidator.sock"  // where the daemon listens unless told otherwise
+#define SV_MAGIC 0x53565631                         // "SVV1", first word of every frame
+#define SV_SCENE 1                                  // frame types
+#define SV_MODELS 2
+#define POSE_BYTES (4 + 7*8)                        // one pose on the wire
+#define SV_MAX_OBJECTS 200                          // most poses in one scene request
+
+
+struct FrameHeader {
+    uint32_t magic;                   //SV_MAGIC
+    uint32_t type;                    //SV_SCENE or SV_MODELS
+    uint32_t id;                      //chosen by the client, the reply has the same one
+    int32_t  count;                   //poses in a request, verdict or number of models in a reply
+};
+
+
+/* writes/reads exactly size bytes, returns false if the socket closed or failed */
+bool writeAll(int fd, const void *data, size_t size);
+bool readAll(int fd, void *data, size_t size);
+
+/* converts count poses to and from their wire form, buffer holds count*POSE_BYTES bytes */
+void packPoses(const ModelPose *poses, int count, char *buffer);
+void unpackPoses(const char *buffer, int count, ModelPose *poses);
+
+#endif
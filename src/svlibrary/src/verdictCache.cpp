@@ -0,0 +1,68 @@
+/****************************************************/
+//Description:  Least recently used verdict cache, see verdictCache.h
+/****************************************************/
+
+#include "verdictCache.h"
+
+using namespace std;
+
+
+VerdictCache::VerdictCache(int capacity) : hits(0), misses(0), capacity(capacity){
+}
+
+
+bool VerdictCache::find(const string &key, bool &valid){
+  auto found = index.find(key);
+  if (found == index.end()){
+    misses++;
+    return false;
+  }
+  entries.splice(entries.begin(), entries, found->second);  //now the most recently used
+  valid = found->second->second;
+  hits++;
+  return true;
+}
+
+
+void VerdictCache::insert(const string &key, bool valid){
+  if (capacity <= 0){
+    return;
+  }
+  auto found = index.find(key);
+  if (found != index.end()){
+    found->second->second = valid;
+    entries.splice(entries.begin(), entries, found->second);
+    return;
+  }
+  entries.push_front(make_pair(key, valid));
+  index[key] = entries.begin();
+  if (entries.size() > capacity){  //throw out the least recently used
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+}
+
+
+void VerdictCache::clear(){
+  entries.clear();
+  index.clear();
+}
+
+
+void VerdictCache::setCapacity(int newCapacity){
+  capacity = newCapacity;
+  while (entries.size() > 0 && entries.size() > capacity){
+    index.erase(entries.back().first);
+    entries.pop_back();
+  }
+}
+
+
+int VerdictCache::getCapacity(){
+  return capacity;
+}
+
+
+int VerdictCache::size(){
+  return entries.size();
+}
@@ -0,0 +1,42 @@
+/****************************************************/
+//Description:  A bounded cache of scene verdicts.  Keys are strings describing a scene (or part of one), the least
+//              recently used entry is thrown out when the cache is full.
+/****************************************************/
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#ifndef VERDICTCACHE_H
+#define VERDICTCACHE_H
+
+
+class VerdictCache{
+    public:
+        VerdictCache(int capacity = 0);
+
+        /* Looks up key. Returns true and sets valid if it's cached (and makes it the most recently used entry) */
+        bool find(const std::string &key, bool &valid);
+
+        /* Adds or replaces key, throwing out the least recently used entry if the cache is full */
+        void insert(const std::string &key, bool valid);
+
+        /* Removes everything, the hit and miss counters are kept */
+        void clear();
+
+        /* Most entries kept, 0 turns the cache off */
+        void setCapacity(int capacity);
+        int  getCapacity();
+        int  size();
+
+        long hits;                         //find() calls that found their key
+        long misses;                       //find() calls that didn't
+
+    private:
+        typedef std::list< std::pair<std::string,bool> > EntryList;
+        EntryList entries;                 //most recently used first
+        std::unordered_map<std::string, EntryList::iterator> index;
+        int capacity;
+};
+
+#endif